@@ -0,0 +1,82 @@
+/**
+ * @file arena.h
+ * @brief Arena class definition
+ *
+ * Defines the Arena bump allocator and implements its inline methods
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <cstdlib>
+#include <new>
+
+/**
+ * @class Arena
+ * Bump allocator for the tables of the clustering engines. Memory is taken
+ * from large blocks in order, nothing is freed individually, and reset()
+ * releases everything at once while keeping the blocks for the next run.
+ * Allocated objects are not constructed nor destroyed, so it is only meant
+ * for plain data.
+ */
+class Arena
+{
+    private:
+
+        std::vector<char*> blocks_;         // Blocks owned by the arena
+        std::vector<size_t> blockSizes_;    // Size of each block
+        int current_;                       // Block being filled
+        size_t used_;                       // Bytes used in current_
+
+        Arena(const Arena&);                // Not copyable
+        Arena &operator=(const Arena&);
+
+    public:
+
+        /**
+        * Constructor. No memory is taken until the first allocation.
+        */
+        Arena() : current_(0), used_(0){};
+
+        ~Arena()
+        {
+            for (int i=0; i<blocks_.size(); i++) free(blocks_[i]);
+        };
+
+        /**
+        * Returns uninitialized memory for n objects of type T, aligned to
+        * 64 bytes
+        * @param n Number of objects
+        * @return pointer Pointer to the first object
+        */
+        template <class T> T *allocate(size_t n)
+        {
+            size_t bytes=(n*sizeof(T)+63) & ~(size_t)63;
+            while (current_<blocks_.size() &&
+                   used_+bytes>blockSizes_[current_])
+            {
+                current_++;         // Move on to the next kept block
+                used_=0;
+            }
+            if (current_==blocks_.size())
+            {
+                size_t size = (bytes > (1<<20)) ? bytes : (1<<20);
+                void *block=0;
+                if (posix_memalign(&block,64,size)!=0) throw std::bad_alloc();
+                blocks_.push_back((char*)block);
+                blockSizes_.push_back(size);
+                used_=0;
+            }
+            T *pointer=(T*)(blocks_[current_]+used_);
+            used_+=bytes;
+            return pointer;
+        };
+
+        /**
+        * Releases all the allocations. The blocks are kept for reuse.
+        */
+        void reset(){current_=0; used_=0;};
+};
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file benchmark.cpp
+ * @brief Implementation of functions for performance measurements
+ *
+ * Implements the wall-clock timer and counts the heap allocations by
+ * replacing the global operator new and operator delete
+ */
+
+#include <cstdlib>
+#include <new>
+#include <sys/time.h>
+#include "benchmark.h"
+
+
+static volatile bool countAllocations=false; // Count the calls to new?
+static volatile long allocationCount=0;      // Calls to new counted
+static volatile long allocationBytes=0;      // Bytes requested by them
+
+double wallTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv,0);
+    return tv.tv_sec+tv.tv_usec*1e-6;
+}
+
+void setAllocationCounting(bool enabled)
+{
+    countAllocations=enabled;
+}
+
+long getAllocationCount()
+{
+    return allocationCount;
+}
+
+long getAllocationBytes()
+{
+    return allocationBytes;
+}
+
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+    if (countAllocations)
+    {
+        __sync_fetch_and_add(&allocationCount,1);
+        __sync_fetch_and_add(&allocationBytes,(long)size);
+    }
+    void *p=malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) throw()
+{
+    free(p);
+}
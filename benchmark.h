@@ -0,0 +1,38 @@
+/**
+ * @file benchmark.h
+ * @brief Definition of functions for performance measurements
+ *
+ * Defines the wall-clock timer and the heap allocation counter used by the
+ * --benchmark option
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/**
+ * Returns the wall-clock time
+ * @return seconds Seconds since the epoch, with microsecond resolution
+ */
+double wallTime();
+
+/**
+ * Starts or stops counting the calls to operator new. Counting is off
+ * by default.
+ * @param enabled TRUE to count the allocations
+ */
+void setAllocationCounting(bool enabled);
+
+/**
+ * Returns the number of calls to operator new counted so far
+ * @return count
+ */
+long getAllocationCount();
+
+/**
+ * Returns the number of bytes requested by the calls to operator new
+ * counted so far
+ * @return bytes
+ */
+long getAllocationBytes();
+
+#endif
@@ -2,67 +2,176 @@
  * @file cluster.cpp
  * @brief Implementation of methods for Cluster class
  *
- * This file contains the implementations of the calcCentroid and
+ * This file contains the implementations of the calcCentroid, calcMean and
  * calcMaxDistance methods.
  * calcCentroid assigns the cluster centroid and the cluster radius.
  * The centroid is defined as the element whose max distances to any
  * other member is the smallest.
+ * calcMean assigns the cluster mean, the element whose sum of distances to
+ * the other members is the smallest, and the pairwise distance statistics.
+ * calcApproxMean estimates the mean from a sample of distances.
  * calcMaxDistance calculates the maximum distance between any two two
  * members of the cluster.
+ * calcStatistics computes all of the above in a single sweep, or from the
+ * per-member row statistics carried through the merges that formed it.
+ * The sweeps are done by reduceMemberRows, which runs in parallel for
+ * large clusters.
  */
 
 
 #include "node.h"
 #include "cluster.h"
-#include <iostream>
+#include "kernels.h"
+#include "kmedoids.h"
+#include <iostream>
 #include <fstream>
 
 
-void Cluster::calcCentroid(vector< vector<float> > normScores)
+MemberPool Cluster::pool_;
+
+void Cluster::init()
+{
+    centroid_= (size_>0) ? pool_.node(head_) : shared_ptr<Node>();
+    mean_=centroid_;
+    meanError_=0;
+    radius_=0;
+    distanceSum_=0;
+    pairs_=0;
+    avDistance_=0;
+    // The statistics of a single element are trivial
+    rowsValid_=(size_==1);
+    if (rowsValid_)
+    {
+        rowSums_.assign(1,0);
+        rowMax_.assign(1,0);
+    }
+    active_=true;
+}
+
+void Cluster::calcCentroid(const vector< vector<float> > &normScores)
 {
-        float distToNeighbors;
-        float minDistanceSum;
-        float currentRadius;
-        for (int i=0;i<members_.size();i++)
+        vector<int> ids;
+        getMembers().copyIds(ids);
+        vector<float> rowSums(ids.size());
+        vector<float> rowMax(ids.size());
+        if (ids.empty()) return;
+        reduceMemberRows(normScores,ids,&rowSums[0],&rowMax[0]);
+        float minRadius=0;
+        for (int i=0;i<ids.size();i++)
         {
-            distToNeighbors=0;
-            currentRadius=0;
-            for (int j=0;j<members_.size();j++)
-            {
-                float d;
-                d = normScores[members_[i]->getID()][members_[j]->getID()];
-                //if (i!=j) {distToNeighbors += d;};
-                currentRadius = (d > currentRadius) ? d : currentRadius;
-            }
-            if (i==0)
+            if (i==0 || rowMax[i]<minRadius)
             {
-                minDistanceSum=currentRadius;
-                radius_=currentRadius;
+                minRadius=rowMax[i];
+                centroid_=pool_.node(ids[i]);
             }
+        }
+        radius_=minRadius;
+}
 
-            //if (distToNeighbors<minDistanceSum)
-            if (currentRadius<minDistanceSum)
-            {
-                //minDistanceSum=distToNeighbors;
-                minDistanceSum=currentRadius;
-                centroid_=members_[i];
-                radius_=currentRadius;
-            }
+void Cluster::calcMean(const vector< vector<float> > &normScores)
+{
+    if (size_==0) return;
+    vector<int> ids;
+    getMembers().copyIds(ids);
+    vector<float> rowSums(ids.size());
+    vector<float> rowMax(ids.size());
+    reduceMemberRows(normScores,ids,&rowSums[0],&rowMax[0]);
+    float minDistanceSum=0;
+    float totalSum=0;
+    for (int i=0;i<ids.size();i++)
+    {
+        totalSum+=rowSums[i];
+        if (i==0 || rowSums[i]<minDistanceSum)
+        {
+            minDistanceSum=rowSums[i];
+            mean_=pool_.node(ids[i]);
         }
+    }
+    distanceSum_=totalSum/2;  // Every pair was counted twice
+    pairs_=(double)size_*(size_-1)/2;
+    avDistance_= (pairs_>0) ? distanceSum_/pairs_ : 0;
+    meanError_=0;
 }
 
-void Cluster::calcMaxDistance(vector< vector<float> > normScores)
+float Cluster::calcApproxMean(const vector< vector<float> > &normScores,
+                              int samples)
+{
+    if (size_==0) return 0;
+    vector<int> ids;
+    getMembers().copyIds(ids);
+    int incumbent= mean_ ? mean_->getID() : -1;
+    int medoid;
+    meanError_=estimateMedoid(normScores,ids,samples,incumbent,medoid);
+    mean_=pool_.node(medoid);
+    return meanError_;
+}
+
+void Cluster::calcMaxDistance(const vector< vector<float> > &normScores)
 {
     float maxDistance=0;
-    float d;
-    for (int i=0;i<members_.size();i++)
+    vector<int> ids;
+    getMembers().copyIds(ids);
+    vector<float> rowSums(ids.size());
+    vector<float> rowMax(ids.size());
+    if (!ids.empty())
     {
-        for (int j=0;j<members_.size();j++)
-            {
-                d=normScores[members_[i]->getID()][members_[j]->getID()];
-                maxDistance = d > maxDistance ? d : maxDistance;
-            }
+        reduceMemberRows(normScores,ids,&rowSums[0],&rowMax[0]);
+    }
+    for (int i=0;i<ids.size();i++)
+    {
+        maxDistance = rowMax[i] > maxDistance ? rowMax[i] : maxDistance;
     }
     maxDistance_=maxDistance;
 }
 
+void Cluster::calcStatistics(const vector< vector<float> > &normScores)
+{
+    int m=size_;
+    if (m==0) return;
+    if (rowsValid_)
+    {
+        deriveStatistics();
+        return;
+    }
+
+    vector<int> ids;        // Contiguous member identifiers
+    getMembers().copyIds(ids);
+
+    rowSums_.resize(m);
+    rowMax_.resize(m);
+    reduceMemberRows(normScores,ids,&rowSums_[0],&rowMax_[0]);
+    double totalSum=0;
+    for (int i=0;i<m;i++) totalSum+=rowSums_[i];
+    distanceSum_=totalSum/2;  // Every pair was counted twice
+    rowsValid_=true;
+    deriveStatistics();
+}
+
+void Cluster::deriveStatistics()
+{
+    int m=size_;
+    float minRowMax=0;
+    float minRowSum=0;
+    float maxDistance=0;
+    int i=0;
+    MemberView members=getMembers();
+    for (MemberView::iterator it=members.begin(); it!=members.end(); ++it,++i)
+    {
+        if (i==0 || rowMax_[i]<minRowMax)
+        {
+            minRowMax=rowMax_[i];
+            centroid_=pool_.node(*it);
+        }
+        if (i==0 || rowSums_[i]<minRowSum)
+        {
+            minRowSum=rowSums_[i];
+            mean_=pool_.node(*it);
+        }
+        maxDistance = (rowMax_[i] > maxDistance) ? rowMax_[i] : maxDistance;
+    }
+    radius_=minRowMax;
+    meanError_=0;
+    maxDistance_=maxDistance;
+    pairs_=(double)m*(m-1)/2;
+    avDistance_= (pairs_>0) ? distanceSum_/pairs_ : 0;
+}
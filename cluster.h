@@ -11,52 +11,81 @@
 #include <vector>
 #include <tr1/memory>
 using namespace std;
-using namespace std::tr1;
+using namespace std::tr1;
+
+class Node; // Forward declaration of Node class
+
+#include "member_pool.h"
 
 
 /**
  * @class Cluster
  * Represents each cluster generated in the process.
- * It holds a cluster identifier, a pointer to a vector of members,
+ * It holds a cluster identifier, a range of members in the MemberPool,
  * the maximum distance within members of the cluster, the cluster
  * centroid (member with smallest max distance to other member),
  * the cluster radius and a boolean flag that indicates whether or not
  * the cluster has been merged into a posterior cluster.
  */
 
-class Node; // Forward declaration of Node class
-
 class Cluster
 {
     private:
 
+        static MemberPool pool_;            // Members of all the clusters
         int id_;                            // Unique identifier
-        vector<shared_ptr<Node> > members_; /* A vector contaning all the
-                                               elements in this cluster */
+        int head_;                          // First member in pool_
+        int tail_;                          // Last member in pool_
+        int size_;                          // Number of members
         float maxDistance_;                /* The maximum distance between
                                                members of this cluster */
         shared_ptr<Node> centroid_;         // Member with smallest distance
                                             // to all other members (sum)
         float radius_;                      // largest distance from the
                                             // centroid to a member
+        shared_ptr<Node> mean_;             // Member with smallest sum of
+                                            // distances to all other members
+        float meanError_;                   // Estimated error of mean_ in
+                                            // mean distance, 0 if exact
+        double distanceSum_;                // Sum of the distances between
+                                            // every pair of members
+        double pairs_;                      // Number of pairs of members
+        float avDistance_;                  // Average pairwise distance
+        vector<float> rowSums_;             // Sum of the distances from each
+                                            // member to the other members
+        vector<float> rowMax_;              // Largest distance from each
+                                            // member to another member
+        bool rowsValid_;                    // rowSums_, rowMax_ and
+                                            // distanceSum_ are up to date
         bool active_;
 
+        /**
+        * Derives the centroid, radius, mean, maximum distance and average
+        * distance from the per-member row statistics
+        */
+        void deriveStatistics();
+
+        /**
+        * Resets the statistics of a newly built cluster
+        */
+        void init();
+
     public:
 
         /**
         * Constructor
         * @param id Unique identifier
-        * @param members Shared pointer to vector containing cluster members
+        * @param members Vector containing the cluster members, which are
+        *               linked in the MemberPool in this order
         * @param maxDistance Maximum distance between any two members of
         *                   the cluster
         */
         Cluster(int id, vector<shared_ptr<Node> > &members,
-                float maxDistance) : id_(id),members_(members),
+                float maxDistance) : id_(id),size_(members.size()),
                 maxDistance_(maxDistance)
                 {
-                    centroid_=members_[0];
-                    radius_=0;
-                    active_=true;
+                    pool_.link(members,head_,tail_);
+                    init();
                 }
 
         /**
@@ -66,10 +95,34 @@ class Cluster
         int getID(){return id_;};
 
         /**
-        * Returns the shared pointer to the vector of cluster members
-        * @return members
+        * Returns a non-owning view of the cluster members
+        * @return members MemberView over the member identifiers
+        */
+        MemberView getMembers(){return MemberView(&pool_,head_,size_);};
+
+        /**
+        * Returns the number of members
+        * @return size
         */
-        vector<shared_ptr<Node> > getMembers(){return members_;};
+        int getSize(){return size_;};
+
+        /**
+        * Returns the Node of an element of any cluster
+        * @param id Element identifier
+        * @return node Shared pointer to the Node
+        */
+        static shared_ptr<Node> getNode(int id){return pool_.node(id);};
+
+        /**
+        * Replaces the members of the cluster
+        * @param members Vector with the new cluster members, not empty
+        */
+        void setMembers(vector<shared_ptr<Node> > &members)
+        {
+            pool_.link(members,head_,tail_);
+            size_=members.size();
+            rowsValid_=false;
+        };
 
         /**
         * Returns the maximum distance between cluster members
@@ -91,7 +144,7 @@ class Cluster
         * @param normScores A distance matrix with all the normalized
         *                    distances between members
         */
-        void calcCentroid(vector< vector<float> > normScores);
+        void calcCentroid(const vector< vector<float> > &normScores);
 
         /**
         * Calculates the maximum distance between any two members of the
@@ -99,7 +152,93 @@ class Cluster
         * @param normScores A distance matrix with all the normalized
         *                    distances between members
         */
-        void calcMaxDistance(vector< vector<float> > normScores);
+        void calcMaxDistance(const vector< vector<float> > &normScores);
+
+        /**
+        * Calculates the cluster mean (medoid) as the member whose sum of
+        * distances to all other members is the smallest.
+        * It assigns the sum of pairwise distances, the number of pairs and
+        * the average pairwise distance in the process.
+        * @param normScores A distance matrix with all the normalized
+        *                    distances between members
+        */
+        void calcMean(const vector< vector<float> > &normScores);
+
+        /**
+        * Estimates the cluster mean (medoid) from a random sample of
+        * distances, for clusters too large for calcMean. The current mean
+        * is kept unless a member with a smaller exact sum is found. The
+        * other statistics are not updated.
+        * @param normScores A distance matrix with all the normalized
+        *                    distances between members
+        * @param samples Number of reference members sampled
+        * @return error Estimated error of the mean, in average distance
+        */
+        float calcApproxMean(const vector< vector<float> > &normScores,
+                             int samples);
+
+        /**
+        * Calculates all the cluster statistics in a single sweep over the
+        * distances between members: the maximum and the sum of every
+        * member's row give the centroid and radius (as calcCentroid), the
+        * mean, sum, pairs and average distance (as calcMean) and the
+        * maximum distance (as calcMaxDistance).
+        * The sweep is skipped when the row statistics were carried through
+        * the merges that formed the cluster.
+        * @param normScores A distance matrix with all the normalized
+        *                    distances between members
+        */
+        void calcStatistics(const vector< vector<float> > &normScores);
+
+        /**
+        * Sets the row statistics of the cluster when they were carried
+        * through the merges that formed it, so that calcStatistics needs
+        * no sweep
+        * @param rowSums Sum of the distances from each member, in member
+        *               order, to the other members
+        * @param rowMax Largest distance from each member to another member
+        * @param distanceSum Sum of the distances between every pair of
+        *                   members
+        */
+        void setRowStatistics(const vector<float> &rowSums,
+                              const vector<float> &rowMax, double distanceSum)
+        {
+            rowSums_=rowSums;
+            rowMax_=rowMax;
+            distanceSum_=distanceSum;
+            rowsValid_=true;
+        };
+
+        /**
+        * Returns a shared pointer to the cluster mean
+        * @return mean A shared pointer to the mean Node
+        */
+        shared_ptr<Node> getMean(){return mean_;};
+
+        /**
+        * Returns the estimated error of the cluster mean, 0 unless it was
+        * found by calcApproxMean
+        * @return meanError
+        */
+        float getMeanError(){return meanError_;};
+
+        /**
+        * Returns the sum of the distances between every pair of members
+        * @return distanceSum
+        */
+        double getDistanceSum(){return distanceSum_;};
+
+        /**
+        * Returns the number of pairs of members in the cluster
+        * @return pairs
+        */
+        double getPairs(){return pairs_;};
+
+        /**
+        * Returns the average distance between pairs of members
+        * @return avDistance 0 for clusters with a single member
+        */
+        float getAvDistance(){return avDistance_;};
 
         /**
         * Returns a shared pointer to the cluster centroid
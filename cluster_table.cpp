@@ -0,0 +1,159 @@
+/**
+ * @file cluster_table.cpp
+ * @brief Implementation of methods for ClusterTable class
+ *
+ * Implements the initialization, union-find lookup, merges and export of
+ * the cluster table used by the hierarchical clustering engines
+ */
+
+#include <tr1/memory>
+#include <vector>
+#include "node.h"
+#include "cluster.h"
+#include "kernels.h"
+#include "arena.h"
+#include "cluster_table.h"
+
+
+void ClusterTable::init(Arena &arena, int totalNodes)
+{
+    int capacity = (totalNodes>0) ? 2*totalNodes-1 : 0;
+    totalNodes_=totalNodes;
+    totalClusters_=totalNodes;
+    nodeCluster_=arena.allocate<int>(totalNodes);
+    next_=arena.allocate<int>(totalNodes);
+    rowSums_=arena.allocate<float>(totalNodes);
+    rowMax_=arena.allocate<float>(totalNodes);
+    size_=arena.allocate<int>(capacity);
+    parent_=arena.allocate<int>(capacity);
+    maxDistance_=arena.allocate<float>(capacity);
+    head_=arena.allocate<int>(capacity);
+    tail_=arena.allocate<int>(capacity);
+    distanceSum_=arena.allocate<double>(capacity);
+    rowsValid_=true;
+
+    for (int i=0; i<totalNodes; i++)
+    {
+        nodeCluster_[i]=i;
+        next_[i]=-1;
+        rowSums_[i]=0;
+        rowMax_[i]=0;
+        size_[i]=1;
+        parent_[i]=-1;
+        maxDistance_[i]=0;
+        head_[i]=i;
+        tail_[i]=i;
+        distanceSum_[i]=0;
+    }
+}
+
+int ClusterTable::find(int node)
+{
+    int root=nodeCluster_[node];
+    while (parent_[root]>=0) root=parent_[root];
+
+    /* Path compression */
+    int c=nodeCluster_[node];
+    while (parent_[c]>=0)
+    {
+        int p=parent_[c];
+        parent_[c]=root;
+        c=p;
+    }
+    nodeCluster_[node]=root;
+    return root;
+}
+
+int ClusterTable::link(int a, int b, float maxDistance)
+{
+    int c=totalClusters_++;
+    next_[tail_[a]]=head_[b];   // Splice the member chains
+    head_[c]=head_[a];
+    tail_[c]=tail_[b];
+    size_[c]=size_[a]+size_[b];
+    parent_[c]=-1;
+    parent_[a]=c;
+    parent_[b]=c;
+    maxDistance_[c]=maxDistance;
+    distanceSum_[c]=0;
+    return c;
+}
+
+int ClusterTable::merge(int a, int b, float maxDistance)
+{
+    rowsValid_=false;
+    return link(a,b,maxDistance);
+}
+
+int ClusterTable::merge(int a, int b, float maxDistance,
+                        const CrossBlock &block)
+{
+    int i=0;
+    for (int id=head_[a]; id>=0 && i<size_[a]; id=next_[id], i++)
+    {
+        rowSums_[id]+=block.rowSumsA[i];
+        rowMax_[id]= (block.rowMaxA[i]>rowMax_[id]) ?
+                     block.rowMaxA[i] : rowMax_[id];
+    }
+    i=0;
+    for (int id=head_[b]; id>=0 && i<size_[b]; id=next_[id], i++)
+    {
+        rowSums_[id]+=block.rowSumsB[i];
+        rowMax_[id]= (block.rowMaxB[i]>rowMax_[id]) ?
+                     block.rowMaxB[i] : rowMax_[id];
+    }
+    double distanceSum=distanceSum_[a]+distanceSum_[b]+block.distanceSum;
+    int c=link(a,b,maxDistance);
+    distanceSum_[c]=distanceSum;
+    return c;
+}
+
+void ClusterTable::copyIds(int c, vector<int> &ids) const
+{
+    ids.resize(size_[c]);
+    int id=head_[c];
+    for (int i=0; i<size_[c]; i++)
+    {
+        ids[i]=id;
+        id=next_[id];
+    }
+}
+
+void ClusterTable::exportClusters(vector< shared_ptr<Node> > &nodeList,
+                                  vector<shared_ptr<Cluster> > &clusterList,
+                                  int &totalClusters)
+{
+    nodeList.clear();
+    nodeList.reserve(totalNodes_);
+    for (int i=0; i<totalNodes_; i++)
+    {
+        shared_ptr<Node> node(new Node(i,find(i)));
+        nodeList.push_back(node);
+    }
+
+    vector<int> ids;
+    vector< shared_ptr<Node> > members;
+    vector<float> rowSums;
+    vector<float> rowMax;
+    for (int c=0; c<totalClusters_; c++)
+    {
+        if (parent_[c]>=0) continue;
+        copyIds(c,ids);
+        members.resize(ids.size());
+        rowSums.resize(ids.size());
+        rowMax.resize(ids.size());
+        for (int i=0; i<ids.size(); i++)
+        {
+            members[i]=nodeList[ids[i]];
+            rowSums[i]=rowSums_[ids[i]];
+            rowMax[i]=rowMax_[ids[i]];
+        }
+        shared_ptr<Cluster> cluster(new Cluster(c,members,maxDistance_[c]));
+        if (rowsValid_)
+        {
+            cluster->setRowStatistics(rowSums,rowMax,distanceSum_[c]);
+        }
+        clusterList.push_back(cluster);
+    }
+    totalClusters=totalClusters_;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file cluster_table.h
+ * @brief ClusterTable class definition
+ *
+ * Defines the structure-of-arrays table that the hierarchical clustering
+ * engines work on
+ */
+
+#ifndef CLUSTER_TABLE_H
+#define CLUSTER_TABLE_H
+
+/**
+ * @class ClusterTable
+ * Holds the state of a hierarchical clustering as plain arrays indexed by
+ * element or cluster identifier, allocated from an Arena: the cluster of
+ * each element, and the size, parent, member chain and statistics of each
+ * cluster. Clusters 0 to n-1 are the initial singletons and every merge
+ * adds a new identifier, so there are at most 2n-1 clusters. The parent
+ * links form a union-find forest, which makes merges constant time apart
+ * from the statistics update. Node and Cluster objects are only built for
+ * the final clusters, by exportClusters.
+ */
+class ClusterTable
+{
+    private:
+
+        int totalNodes_;        // Number of elements
+        int totalClusters_;     // Clusters created so far
+        int *nodeCluster_;      // Cluster of each element, or one that was
+                                // merged into it
+        int *size_;             // Number of members of each cluster
+        int *parent_;           // Cluster each one was merged into (or a
+                                // later one containing it), -1 if active
+        float *maxDistance_;    // Maximum distance of each cluster
+        int *head_;             // First member of each cluster
+        int *tail_;             // Last member of each cluster
+        int *next_;             // Next member in the same cluster
+        float *rowSums_;        // Sum of distances from each element to
+                                // the other members of its cluster
+        float *rowMax_;         // Largest of those distances
+        double *distanceSum_;   // Sum of pairwise distances of each cluster
+        bool rowsValid_;        // Row statistics carried through all merges
+
+        /**
+        * Adds a cluster with the members of a and b, which become inactive
+        * @return c Identifier of the new cluster
+        */
+        int link(int a, int b, float maxDistance);
+
+    public:
+
+        /**
+        * Allocates the table from an arena and fills it with one singleton
+        * cluster per element
+        * @param arena Arena that holds the arrays, reset by the caller
+        *             between runs
+        * @param totalNodes Number of elements
+        */
+        void init(Arena &arena, int totalNodes);
+
+        /**
+        * Returns the active cluster that contains an element
+        * @param node Element identifier
+        * @return cluster Identifier of the active cluster
+        */
+        int find(int node);
+
+        /**
+        * Returns the number of members of a cluster
+        * @param c Cluster identifier
+        * @return size
+        */
+        int getSize(int c) const {return size_[c];};
+
+        /**
+        * Returns the sum of the pairwise distances within a cluster, only
+        * meaningful while the row statistics are carried through merges
+        * @param c Cluster identifier
+        * @return distanceSum
+        */
+        double getDistanceSum(int c) const {return distanceSum_[c];};
+
+        /**
+        * Updates the maximum distance within a cluster
+        * @param c Cluster identifier
+        * @param maxDistance New maximum distance in the cluster
+        */
+        void setMaxDistance(int c, float maxDistance)
+        {
+            maxDistance_[c]=maxDistance;
+        };
+
+        /**
+        * Merges two active clusters in constant time. The row statistics
+        * are no longer carried.
+        * @param a First cluster
+        * @param b Second cluster
+        * @param maxDistance Distance of the link that joins them
+        * @return c Identifier of the new cluster
+        */
+        int merge(int a, int b, float maxDistance);
+
+        /**
+        * Merges two active clusters and updates the row statistics from the
+        * aggregates of their cross block, in O(|a|+|b|)
+        * @param a First cluster
+        * @param b Second cluster
+        * @param maxDistance Distance of the link that joins them
+        * @param block Aggregates of the distances between a and b
+        * @return c Identifier of the new cluster
+        */
+        int merge(int a, int b, float maxDistance, const CrossBlock &block);
+
+        /**
+        * Copies the members of a cluster into a contiguous array
+        * @param c Cluster identifier
+        * @param ids Vector that receives the member identifiers
+        */
+        void copyIds(int c, vector<int> &ids) const;
+
+        /**
+        * Builds a Node for every element and a Cluster for every active
+        * cluster, with the row statistics if they were carried
+        * @param nodeList Vector of shared pointers to the Nodes, filled
+        * @param clusterList Vector of shared pointers to the Clusters, filled
+        * @param totalClusters Number of cluster identifiers used
+        */
+        void exportClusters(vector< shared_ptr<Node> > &nodeList,
+                            vector<shared_ptr<Cluster> > &clusterList,
+                            int &totalClusters);
+};
+
+#endif
@@ -9,14 +9,19 @@
 #include <boost/algorithm/string.hpp>
 #include <vector>
 #include <queue>
+#include <limits>
 #include "node.h"
 #include "cluster.h"
+#include "kernels.h"
+#include "arena.h"
+#include "cluster_table.h"
 #include "link.h"
 #include "link_comparator.h"
 #include "clustering.h"
+#include "kmedoids.h"
 #include <iostream>
 #include <fstream>
-
+
 
 using namespace std;
 using namespace std::tr1;
@@ -44,13 +49,14 @@ void initNodesAndClusters (int totalNodes,
     }
 }
 
-void initScores(int totalNodes,vector<float> rawScores,
+void initScores(int totalNodes,const vector<float> &rawScores,
                 vector< vector<float> > &normScores)
 {
     float score;
+    normScores.assign(totalNodes,vector<float>(totalNodes)); // Sized once
     for (int i=0; i <(totalNodes); i++)
     {
-        vector <float> row;
+        vector <float> &row=normScores[i];
         for (int j=0;j<totalNodes;j++)
         {
                 if (
@@ -72,62 +78,51 @@ void initScores(int totalNodes,vector<float> rawScores,
                 }
                 if (i==j){score=0;}
                 //printf ("%d %d %f \n",i,j,score);
-                row.push_back(score);
+                row[j]=score;
         }
        // printf ("\n");
-        normScores.push_back(row);
     }
 }
 
-void initLinks (int totalNodes, vector< vector<float> > normScores,
-                priority_queue<Link, vector<Link>, LinkComparator> &linkList,
-                vector< shared_ptr<Node> > nodeList)
+void initLinks (int totalNodes, const vector< vector<float> > &normScores,
+                priority_queue<Link, vector<Link>, LinkComparator> &linkList)
 {
     for (int i=0; i <(totalNodes-1); i++)
     {
         for (int j=i+1;j<totalNodes;j++)
         {
-            linkList.push(Link(nodeList[i],nodeList[j],normScores[i][j]));
+            linkList.push(Link(i,j,normScores[i][j]));
         }
     }
 }
 
 void doHierarchicalCutoff(priority_queue<Link,vector<Link>,
                         LinkComparator> &linkList,
-                        vector<shared_ptr<Cluster> > &clusterList,
-                         int totalClusters,float cutoff)
+                        ClusterTable &table,float cutoff)
 {
     Link nextLink=linkList.top(); // Next link to check
     linkList.pop();
     while (!linkList.empty())
     {
+        int clusterA=table.find(nextLink.getNodeA());
+        int clusterB=table.find(nextLink.getNodeB());
         if (nextLink.getDistance()<cutoff) // Use all the links
         {
-                if (nextLink.getNodeA()->getCluster()!=
-                    nextLink.getNodeB()->getCluster())
+                if (clusterA!=clusterB)
                     // If the linked elements are in different clusters, merge
                 {
-                    shared_ptr<Cluster> clusterC=
-                    mergeClusters(clusterList[nextLink.getNodeA()->
-                                  getCluster()],
-                                  clusterList[nextLink.getNodeB()->
-                                  getCluster()],
-                                  totalClusters++,nextLink.getDistance() );
-                    clusterList.push_back(clusterC);
+                    table.merge(clusterA,clusterB,nextLink.getDistance());
                 }
                 else
                 {
-                    clusterList[nextLink.getNodeA()->getCluster()]->
-                    setMaxDistance(nextLink.getDistance());
+                    table.setMaxDistance(clusterA,nextLink.getDistance());
                 }
         }
         else
         {
-            if (nextLink.getNodeA()->getCluster()==
-                nextLink.getNodeB()->getCluster())
+            if (clusterA==clusterB)
             {
-                    clusterList[nextLink.getNodeA()->getCluster()]->
-                    setMaxDistance(nextLink.getDistance());
+                    table.setMaxDistance(clusterA,nextLink.getDistance());
             }
 
         }
@@ -138,61 +133,40 @@ void doHierarchicalCutoff(priority_queue<Link,vector<Link>,
 
 void doStrictHierarchicalCutoff(priority_queue<Link,vector<Link>,
                         LinkComparator> &linkList,
-                        vector<shared_ptr<Cluster> > &clusterList,
-                         int totalClusters,float cutoff,
-                         vector< vector<float> > normScores)
+                        ClusterTable &table,float cutoff,
+                        const vector< vector<float> > &normScores)
 {
+    CrossBlock block;   // Reused so that its buffers are only grown
     Link nextLink=linkList.top(); // Next link to check
     linkList.pop();
     while (!linkList.empty())
     {
+        int clusterA=table.find(nextLink.getNodeA());
+        int clusterB=table.find(nextLink.getNodeB());
         if (nextLink.getDistance()<cutoff) // Use all the links
         {
-            bool pairWise=true;
-            vector<shared_ptr<Node> > nodesA =
-            clusterList[nextLink.getNodeA()->getCluster()]->getMembers();
-            vector<shared_ptr<Node> > nodesB =
-            clusterList[nextLink.getNodeB()->getCluster()]->getMembers();
-
-            for (int i=0; i < nodesA.size();i++)
+            if (clusterA!=clusterB)
+                // If the linked elements are in different clusters, merge
+                // them if all their pairwise distances are below the cutoff
             {
-                for (int j=0; j < nodesB.size();j++)
+                if (scanCrossBlock(table,clusterA,clusterB,normScores,
+                                   cutoff,block))
                 {
-                    if (normScores[nodesA[i]->getID()][nodesB[j]->getID()]
-                        >=cutoff)
-                        {
-                            pairWise=false;
-                        }
+                    table.merge(clusterA,clusterB,nextLink.getDistance(),
+                                block);
                 }
             }
-            if (pairWise)
+            else
             {
-                if (nextLink.getNodeA()->getCluster()!=
-                    nextLink.getNodeB()->getCluster())
-                    // If the linked elements are in different clusters, merge
-                {
-                    shared_ptr<Cluster> clusterC=
-                    mergeClusters(clusterList[nextLink.getNodeA()->
-                                  getCluster()],
-                                  clusterList[nextLink.getNodeB()->
-                                  getCluster()],
-                                  totalClusters++,nextLink.getDistance() );
-                    clusterList.push_back(clusterC);
-                }
-                else
-                {
-                    clusterList[nextLink.getNodeA()->getCluster()]->
-                    setMaxDistance(nextLink.getDistance());
-                }
+                // All the members of a cluster are within the cutoff
+                table.setMaxDistance(clusterA,nextLink.getDistance());
             }
         }
         else
         {
-            if (nextLink.getNodeA()->getCluster()==
-                nextLink.getNodeB()->getCluster())
+            if (clusterA==clusterB)
             {
-                    clusterList[nextLink.getNodeA()->getCluster()]->
-                    setMaxDistance(nextLink.getDistance());
+                    table.setMaxDistance(clusterA,nextLink.getDistance());
             }
 
         }
@@ -203,64 +177,49 @@ void doStrictHierarchicalCutoff(priority_queue<Link,vector<Link>,
 
 void doUPGMA(priority_queue<Link,vector<Link>,
                         LinkComparator> &linkList,
-                        vector<shared_ptr<Cluster> > &clusterList,
-                         int totalClusters,float cutoff,
-                         vector< vector<float> > normScores)
+                        ClusterTable &table,float cutoff,
+                        const vector< vector<float> > &normScores)
 {
+    CrossBlock block;   // Reused so that its buffers are only grown
     Link nextLink=linkList.top(); // Next link to check
     linkList.pop();
     while (!linkList.empty())
     {
+        int clusterA=table.find(nextLink.getNodeA());
+        int clusterB=table.find(nextLink.getNodeB());
         if (nextLink.getDistance()<cutoff) // Use all the links
         {
-            bool pairWise=false;
-            vector<shared_ptr<Node> > nodesA =
-            clusterList[nextLink.getNodeA()->getCluster()]->getMembers();
-            vector<shared_ptr<Node> > nodesB =
-            clusterList[nextLink.getNodeB()->getCluster()]->getMembers();
-            float dSum=0;
-            float avDist=0;
-
-            for (int i=0; i < nodesA.size();i++)
+            if (clusterA!=clusterB)
+                // If the linked elements are in different clusters, merge
+                // them if their average pairwise distance is below the cutoff
             {
-                for (int j=0; j < nodesB.size();j++)
+                scanCrossBlock(table,clusterA,clusterB,normScores,
+                               std::numeric_limits<float>::max(),block);
+                float avDist=block.distanceSum/
+                             ((double)block.rowSumsA.size()*
+                              block.rowSumsB.size());
+                if (avDist<cutoff)
                 {
-                    dSum+=normScores[nodesA[i]->getID()][nodesB[j]->getID()];
+                    table.merge(clusterA,clusterB,nextLink.getDistance(),
+                                block);
                 }
             }
-            avDist=dSum/(nodesA.size()*nodesB.size());
-            if (avDist<cutoff)
-            {
-                pairWise=true;
-            }
-            if (pairWise)
+            else
             {
-                if (nextLink.getNodeA()->getCluster()!=
-                    nextLink.getNodeB()->getCluster())
-                    // If the linked elements are in different clusters, merge
-                {
-                    shared_ptr<Cluster> clusterC=
-                    mergeClusters(clusterList[nextLink.getNodeA()->
-                                  getCluster()],
-                                  clusterList[nextLink.getNodeB()->
-                                  getCluster()],
-                                  totalClusters++,nextLink.getDistance() );
-                    clusterList.push_back(clusterC);
-                }
-                else
+                // Average over the whole block of the cluster, diagonal
+                // included, from the carried distance sum
+                double m=table.getSize(clusterA);
+                if (2*table.getDistanceSum(clusterA)/(m*m)<cutoff)
                 {
-                    clusterList[nextLink.getNodeA()->getCluster()]->
-                    setMaxDistance(nextLink.getDistance());
+                    table.setMaxDistance(clusterA,nextLink.getDistance());
                 }
             }
         }
         else
         {
-            if (nextLink.getNodeA()->getCluster()==
-                nextLink.getNodeB()->getCluster())
+            if (clusterA==clusterB)
             {
-                    clusterList[nextLink.getNodeA()->getCluster()]->
-                    setMaxDistance(nextLink.getDistance());
+                    table.setMaxDistance(clusterA,nextLink.getDistance());
             }
 
         }
@@ -271,8 +230,7 @@ void doUPGMA(priority_queue<Link,vector<Link>,
 
 void doHierarchical(priority_queue<Link,vector<Link>,
                   LinkComparator> &linkList,
-                  vector<shared_ptr<Cluster> > &clusterList,
-                  int totalClusters)
+                  ClusterTable &table)
 {
 
     while (!linkList.empty()) // Use all the links
@@ -280,28 +238,23 @@ void doHierarchical(priority_queue<Link,vector<Link>,
             Link nextLink=linkList.top(); // Next link to check
             linkList.pop();
 
-            if (nextLink.getNodeA()->getCluster()!= // If the elements of the
-                nextLink.getNodeB()->getCluster())  // link are in different
-                                                    // clusters, join the
-                                                    // clusters
+            int clusterA=table.find(nextLink.getNodeA());
+            int clusterB=table.find(nextLink.getNodeB());
+            if (clusterA!=clusterB) // If the elements of the link are in
+                                    // different clusters, join the clusters
             {
-                shared_ptr<Cluster> clusterC=
-                mergeClusters(clusterList[nextLink.getNodeA()->getCluster()],
-                              clusterList[nextLink.getNodeB()->getCluster()],
-                              totalClusters++,nextLink.getDistance() );
-
-                clusterList.push_back(clusterC);
+                table.merge(clusterA,clusterB,nextLink.getDistance());
             }
     }
 }
 
-void doSpickerCutoff(int totalNodes, vector< vector<float> > normScores,
-                     vector< shared_ptr<Node> > nodeList,
+void doSpickerCutoff(int totalNodes, const vector< vector<float> > &normScores,
+                     const vector< shared_ptr<Node> > &nodeList,
                      vector<shared_ptr<Cluster> > &clusterList,
                      int &totalClusters,float cutoff)
 {
-    vector< vector<float> > tempMatrix=normScores; // A copy of the distance
-                                                    // matrix
+    vector<char> removed(totalNodes,0);   // Columns emptied from the matrix,
+                                          // instead of a copy of the matrix
     int orphans=totalNodes; // Unclustered elements
     int nextCluster=clusterList.size(); // ID for the next generated cluster
 
@@ -322,12 +275,10 @@ loop, where the matrix is emptied would still be necessary. */
         for (int i =0 ; i<totalNodes;i++)
         {
             nbCount=0;
+            const float *row=&normScores[i][0];
             for (int j = 0 ; j< totalNodes;j++)
             {
-                if ( (tempMatrix[i][j]<cutoff) && (tempMatrix[i][j]>=0) )
-                {
-                    nbCount++;
-                }
+                nbCount+= (!removed[j] && row[j]<cutoff && row[j]>=0);
             }
             maxRow = nbCount >= maxNb ? i : maxRow;
             maxNb = nbCount >= maxNb ? nbCount : maxNb;
@@ -337,26 +288,22 @@ loop, where the matrix is emptied would still be necessary. */
 reducing its size and thus making the next iteration faster */
 
 /** Push the elements of maxRow above the threshold to an array of pointers
- to Nodes and make a cluster out of them. Empty the matrix by setting the
- values to -1 */
+ to Nodes and make a cluster out of them. Empty the matrix by removing
+ their columns */
         for (int i = 0 ; i<totalNodes ; i++)
         {
             shared_ptr<Node> node;
-            if ( (tempMatrix[maxRow][i]<cutoff) && (tempMatrix[maxRow][i]>=0) )
+            float d=normScores[maxRow][i];
+            if ( !removed[i] && (d<cutoff) && (d>=0) )
             {
                 /* Add each element below cutoff to the vector of cluster
-                members and set the matrix value to -1*/
+                members and remove its column */
                 node=nodeList[i];
                 clusterMembers.push_back(node);
                 clusterList[node->getCluster()]->setStatus();
                 node->setCluster(nextCluster);
-                tempMatrix[maxRow][i]=-1;
                 orphans--;
-
-                for (int j=0;j<totalNodes;j++)
-                {
-                    tempMatrix[j][i]=-1; // Reset values on all columns also!
-                }
+                removed[i]=1;
             }
 
         }
@@ -372,14 +319,15 @@ reducing its size and thus making the next iteration faster */
 }
 
 
-void doKMeans(int totalNodes, vector< vector<float> > normScores,
-                     vector< shared_ptr<Node> > nodeList,
+void doKMeans(int totalNodes, const vector< vector<float> > &normScores,
+                     const vector< shared_ptr<Node> > &nodeList,
                      vector<shared_ptr<Cluster> > &clusterList,
-                     int &totalClusters, float kMeans)
+                     int &totalClusters, float kMeans, int approxSamples)
  {
     /* Initialize the k clusters */
-    float dToMean;
-    vector< shared_ptr<Node> > means;
+    vector<int> means;      // Identifiers of the k means, contiguous so
+                            // that the assignment does not chase pointers
+    vector<int> labels;     // Mean assigned to each element
     vector< vector<shared_ptr<Node> > > kMembers;
     // Make all clusters inactive
     for (int i=0; i<totalNodes ; i++)
@@ -388,7 +336,6 @@ void doKMeans(int totalNodes, vector< vector<float> > normScores,
     }
 
     // Create k new clusters at the beginning of the nodeList
-    srand (time(NULL));
     for (int i =0; i<kMeans ; i++)
     {
         int newMean= rand() % totalNodes;
@@ -398,7 +345,7 @@ void doKMeans(int totalNodes, vector< vector<float> > normScores,
             unique=true;
             for (int j=0;j<i;j++)
             {
-                if (newMean==means[j]->getID())
+                if (newMean==means[j])
                 {
                     unique=false;
                     newMean= rand() % totalNodes;
@@ -406,112 +353,152 @@ void doKMeans(int totalNodes, vector< vector<float> > normScores,
             }
 
         }
-        means.push_back(nodeList[newMean]);
+        means.push_back(newMean);
         vector< shared_ptr<Node> > iMember;
         kMembers.push_back(iMember);
-        iMember.push_back(means[i]);
+        iMember.push_back(nodeList[newMean]);
         shared_ptr<Cluster> newCluster (new Cluster(i,iMember,0));
         clusterList.insert(clusterList.begin()+i,newCluster);
-        means[i]->setCluster(i);
+        nodeList[newMean]->setCluster(i);
     }
 
-    // Assign each element to the closest of the k new clusters
-    for (int i=0; i<totalNodes ; i++)
+    bool convergence=false;
+    while (true)
     {
-        float minDistToMean=std::numeric_limits<float>::max();
-        shared_ptr<Node> closestMean=means[0];
+        /* Assign each element to the closest of the k means. The labels are
+           computed in parallel, the member lists are then filled in a
+           single pass */
+        assignToMedoids(totalNodes,normScores,means,labels);
+        vector<int> memberCount(means.size(),0);
+        for (int i=0; i<totalNodes ; i++)
+        {
+            memberCount[labels[i]]++;
+        }
         for (int k=0; k<kMeans; k++)
         {
-            dToMean=normScores[nodeList[i]->getID()][means[k]->getID()];
-            if (dToMean<minDistToMean)
-            {
-                minDistToMean=dToMean;
-                closestMean=means[k];
-              //  printf ("found a pair %d %d %f\n", i,k,dToMean);
-            }
+            kMembers[k].clear();
+            kMembers[k].reserve(memberCount[k]);
         }
-        nodeList[i]->setCluster(closestMean->getCluster());
-        kMembers[closestMean->getCluster()].push_back(nodeList[i]);
-    }
-
-    for (int i =0; i<kMeans ; i++)
-    {
-        //printf("Cluster %d mean %d\n",clusterList[i]->getID(),clusterList[i]->getMean()->getID());
-        clusterList[i]->setMembers(kMembers[i]);
-    }
-
+        for (int i=0; i<totalNodes ; i++)
+        {
+            nodeList[i]->setCluster(labels[i]);
+            kMembers[labels[i]].push_back(nodeList[i]);
+        }
+        for (int k=0; k<kMeans; k++)
+        {
+            clusterList[k]->setMembers(kMembers[k]);
+        }
+        if (convergence) break;
 
-    bool convergence=false;
-    int iteration=0;
-    do
-    {
         convergence=true;
         /* Re-assign the mean */
-        for (int i =0; i<kMeans ; i++)
+        for (int k=0; k<kMeans ; k++)
         {
-            int oldMean=clusterList[i]->getMean()->getID();
-                    //printf("Cluster %d oldmean %d\n",clusterList[i]->getID(),oldMean);
-            clusterList[i]->calcMean(normScores);
-                    //printf("Cluster %d mean %d\n",clusterList[i]->getID(),clusterList[i]->getMean()->getID());
-
-            if (oldMean!=clusterList[i]->getMean()->getID())
+            if (approxSamples>0)
             {
-                convergence=false;
+                clusterList[k]->calcApproxMean(normScores,approxSamples);
             }
-            means[i]=clusterList[i]->getMean();
-            kMembers[i].clear();
-        }
-        //printf("iteration %d convergence %d \n", iteration, convergence);
-        /* Update members based on new means */
-        for (int i=0; i<totalNodes ; i++)
-        {
-            float minDistToMean=std::numeric_limits<float>::max();
-            shared_ptr<Node> closestMean=means[0];
-            for (int k=0; k<kMeans; k++)
+            else
             {
-                dToMean=normScores[nodeList[i]->getID()][means[k]->getID()];
-                if (dToMean<minDistToMean)
-                {
-                    minDistToMean=dToMean;
-                    closestMean=means[k];
-                  //  printf ("found a pair %d %d %f\n", i,k,dToMean);
-                }
+                clusterList[k]->calcMean(normScores);
             }
-            nodeList[i]->setCluster(closestMean->getCluster());
-            kMembers[closestMean->getCluster()].push_back(nodeList[i]);
+            if (means[k]!=clusterList[k]->getMean()->getID())
+            {
+                convergence=false;
+            }
+            means[k]=clusterList[k]->getMean()->getID();
         }
-        for (int i =0; i<kMeans ; i++)
+    }
+    if (approxSamples>0)
+    {
+        float maxError=0;
+        for (int k=0; k<kMeans ; k++)
         {
-            clusterList[i]->setMembers(kMembers[i]);
+            float error=clusterList[k]->getMeanError();
+            maxError = (error>maxError) ? error : maxError;
         }
-        iteration++;
-    }while (!convergence);
-
-
+        printf("Approximate means, largest estimated error %f\n",maxError);
+    }
  }
 
-shared_ptr<Cluster> mergeClusters(shared_ptr<Cluster> A,shared_ptr<Cluster> B,
-                                  int nextCluster,float maxDistance)
+void doKCenter(int totalNodes, const vector< vector<float> > &normScores,
+               vector< shared_ptr<Node> > &nodeList,
+               vector<shared_ptr<Cluster> > &clusterList,
+               int &totalClusters, float cutoff, int maxCenters)
 {
-        vector<shared_ptr<Node> > clusterMembers;
+    if (totalNodes==0) return;
+    maxCenters = (maxCenters<=0 || maxCenters>totalNodes) ?
+                 totalNodes : maxCenters;
+    vector<int> centers;
+    vector<int> labels(totalNodes,0);
+    vector<float> dNearest(normScores[0]); // Distance to the closest center
+    centers.push_back(0);
+
+    while (centers.size()<maxCenters)
+    {
+        /* The farthest element defines the current covering radius */
+        int farthest=0;
+        for (int i=1; i<totalNodes; i++)
+        {
+            farthest = (dNearest[i]>dNearest[farthest]) ? i : farthest;
+        }
+        if (dNearest[farthest]<cutoff) break;
+
+        /* Branch-free minimum update so that the loop is vectorized */
+        int newLabel=centers.size();
+        const float *row=&normScores[farthest][0];
+        float *d=&dNearest[0];
+        int *l=&labels[0];
+        for (int i=0; i<totalNodes; i++)
+        {
+            bool closer = row[i] < d[i];
+            l[i] = closer ? newLabel : l[i];
+            d[i] = closer ? row[i] : d[i];
+        }
+        centers.push_back(farthest);
+    }
+
+    makeClustersFromLabels(labels,centers.size(),nodeList,clusterList,
+                           totalClusters);
+}
 
-        for (int i=0; i < A->getMembers().size();i++)
+void makeClustersFromLabels(const vector<int> &labels, int k,
+                            vector< shared_ptr<Node> > &nodeList,
+                            vector<shared_ptr<Cluster> > &clusterList,
+                            int &totalClusters)
+{
+    vector< vector<shared_ptr<Node> > > kMembers(k);
+    for (int i=0; i<nodeList.size(); i++)
+    {
+        shared_ptr<Cluster> oldCluster=clusterList[nodeList[i]->getCluster()];
+        if (oldCluster->getStatus())
         {
-            shared_ptr<Node> node=A->getMembers()[i];
-            clusterMembers.push_back(node);
-            node->setCluster(nextCluster);
+            oldCluster->setStatus();
         }
+        kMembers[labels[i]].push_back(nodeList[i]);
+    }
 
-        for (int j=0; j < B->getMembers().size();j++)
+    int nextCluster=clusterList.size(); // ID for the next generated cluster
+    for (int c=0; c<k; c++)
+    {
+        if (kMembers[c].empty()) continue;
+        for (int j=0; j<kMembers[c].size(); j++)
         {
-            shared_ptr<Node> node=B->getMembers()[j];
-            clusterMembers.push_back(node);
-            node->setCluster(nextCluster);
+            kMembers[c][j]->setCluster(nextCluster);
         }
+        shared_ptr<Cluster> newCluster (new Cluster(nextCluster,
+                                                    kMembers[c],0));
+        clusterList.push_back(newCluster);
+        nextCluster++;
+    }
+    totalClusters=nextCluster;
+}
 
-        A->setStatus();
-        B->setStatus();
-        shared_ptr<Cluster> C (new Cluster(nextCluster,clusterMembers,
-                                           maxDistance));
-        return C;
+bool scanCrossBlock(const ClusterTable &table, int a, int b,
+                    const vector< vector<float> > &normScores,
+                    float stopAt, CrossBlock &block)
+{
+    table.copyIds(a,block.idsA);
+    table.copyIds(b,block.idsB);
+    return reduceCrossBlock(normScores,block.idsA,block.idsB,stopAt,block);
 }
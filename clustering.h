@@ -29,37 +29,33 @@ void initNodesAndClusters (int totalNodes, vector< shared_ptr<Node> > &nodeList,
  * @param normScores Vector of vectors representing a normalized matrix of
  *                  distances between nodes
  */
-void initScores(int totalNodes,vector<float> rawScores,
+void initScores(int totalNodes,const vector<float> &rawScores,
                 vector< vector<float> > &normScores);
 
 
 /**
- * Creates Links between each pair of nodes on the nodeList using the
- * normalized distance from the normScores matrix.
- * @param totalNodes Total number of nodes on the nodeList
+ * Creates Links between each pair of elements using the normalized distance
+ * from the normScores matrix.
+ * @param totalNodes Total number of elements
  * @param normScores Vector of vectors representing a normalized matrix of
  *                  distances between nodes
  * @param linkList Priority Queue that holds the Links in increasing order of
  *                distance
- * @param nodeList Vector of shared pointers to the Nodes
  */
-void initLinks (int totalNodes, vector< vector<float> > normScores,
-                priority_queue<Link, vector<Link>, LinkComparator> &linkList,
-                vector< shared_ptr<Node> > nodeList);
+void initLinks (int totalNodes, const vector< vector<float> > &normScores,
+                priority_queue<Link, vector<Link>, LinkComparator> &linkList);
 
 
 /**
  * Function for performing Hierarchical Clustering on the data set
  * Goes through all the Links in linkList and whenever two elements are not in
- * the same Cluster, merges their clusters into a new one. New clusters are
- * added to clusterList and the Cluster identifier on the Nodes are updated
+ * the same Cluster, merges their clusters into a new one in the table
  * @param linkList Priority Queue that holds the Links in increasing order of
  *                distance
- * @param clusterList Vector of shared pointers to all the existing clusters
- * @param totalClusters Number of existing clusters
+ * @param table ClusterTable with the current clusters
  */
 void doHierarchical(priority_queue<Link,vector<Link>,LinkComparator> &linkList,
-                  vector<shared_ptr<Cluster> > &clusterList, int totalClusters);
+                    ClusterTable &table);
 
 /**
  * Function for performing Hierarchical Clustering on the data set using cutoff
@@ -67,15 +63,13 @@ void doHierarchical(priority_queue<Link,vector<Link>,LinkComparator> &linkList,
  * given cutoff.
  * @param linkList Priority Queue that holds the Links in increasing order of
  *                distance
- * @param clusterList Vector of shared pointers to all the existing clusters
- * @param totalClusters Number of existing clusters
+ * @param table ClusterTable with the current clusters
  * @param cutoff A distance limit. Only links below it are considered for the
  *              clustering. The process stops when the limit is reached.
  */
 void doHierarchicalCutoff(priority_queue<Link,vector<Link>,
                         LinkComparator> &linkList,
-                        vector<shared_ptr<Cluster> > &clusterList,
-                        int totalClusters,float cutoff);
+                        ClusterTable &table,float cutoff);
 
 /**
  * Function for performing Strict Hierarchical Clustering on the data set using
@@ -83,16 +77,15 @@ void doHierarchicalCutoff(priority_queue<Link,vector<Link>,
  * given cutoff.
  * @param linkList Priority Queue that holds the Links in increasing order of
  *                distance
- * @param clusterList Vector of shared pointers to all the existing clusters
- * @param totalClusters Number of existing clusters
+ * @param table ClusterTable with the current clusters
  * @param cutoff A distance limit. Only links below it are considered for the
  *              clustering. The process stops when the limit is reached.
+ * @param normScores Vector of vector of floats represeting the distance matrix
  */
 void doStrictHierarchicalCutoff(priority_queue<Link,vector<Link>,
                         LinkComparator> &linkList,
-                        vector<shared_ptr<Cluster> > &clusterList,
-                        int totalClusters,float cutoff,
-                        vector< vector<float> > normScores);
+                        ClusterTable &table,float cutoff,
+                        const vector< vector<float> > &normScores);
 
 /**
  * Function for performing UPGMA on the data set using a given cutoff.
@@ -100,31 +93,47 @@ void doStrictHierarchicalCutoff(priority_queue<Link,vector<Link>,
  * given cutoff.
  * @param linkList Priority Queue that holds the Links in increasing order of
  *                distance
- * @param clusterList Vector of shared pointers to all the existing clusters
- * @param totalClusters Number of existing clusters
+ * @param table ClusterTable with the current clusters
  * @param cutoff A distance limit. Only links below it are considered for the
  *              clustering. The process stops when the limit is reached.
+ * @param normScores Vector of vector of floats represeting the distance matrix
  */
 void doUPGMA(priority_queue<Link,vector<Link>,
                         LinkComparator> &linkList,
-                        vector<shared_ptr<Cluster> > &clusterList,
-                        int totalClusters,float cutoff,
-                        vector< vector<float> > normScores);
+                        ClusterTable &table,float cutoff,
+                        const vector< vector<float> > &normScores);
 
 /**
- * Joins two clusters A and B into a new Cluster C
- * that contains all the elements of A and all the elements of B
- * @param A Shared pointer to the first Cluster to join
- * @param B Shared pointer to the second Cluster to join
- * @param nextCluster Unique identifier for the Cluster to be generated
- * @param maxDistance Distance between the Node of A and the Node of B that are
- *                   connected
- * @return C Shared pointer to the newly generated Cluster
+ * Scans the distances between every member of cluster a and every member of
+ * cluster b with reduceCrossBlock, collecting their smallest and largest
+ * value, their sum and the per-member row sums and maxima
+ * @param table ClusterTable holding both clusters
+ * @param a First cluster
+ * @param b Second cluster
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param stopAt Distance that ends the scan early
+ * @param block CrossBlock to fill
+ * @return complete FALSE if some distance reached stopAt
  */
-shared_ptr<Cluster> mergeClusters(shared_ptr<Cluster> A,shared_ptr<Cluster> B,
-                                  int nextCluster,float maxDistance);
+bool scanCrossBlock(const ClusterTable &table, int a, int b,
+                    const vector< vector<float> > &normScores,
+                    float stopAt, CrossBlock &block);
 
 
+/**
+ * Replaces the current clusters of the elements with new clusters built from
+ * a label array. All the clusters the elements belonged to are deactivated
+ * and one new Cluster is added to clusterList for every non-empty label.
+ * @param labels Label (0 to k-1) of every element
+ * @param k Number of different labels
+ * @param nodeList Vector of shared pointers to the Nodes
+ * @param clusterList Vector of shared pointers to the Clusters
+ * @param totalClusters Total number of clusters
+ */
+void makeClustersFromLabels(const vector<int> &labels, int k,
+                            vector< shared_ptr<Node> > &nodeList,
+                            vector<shared_ptr<Cluster> > &clusterList,
+                            int &totalClusters);
 
 /**
  * Function for performing clustering based on the SPICKER method
@@ -139,8 +148,8 @@ shared_ptr<Cluster> mergeClusters(shared_ptr<Cluster> A,shared_ptr<Cluster> B,
  * @param totalClusters Total number of clusters
  * @param cutoff Distance cutoff used to perform the clustering
  */
-void doSpickerCutoff(int totalNodes, vector< vector<float> > normScores,
-                     vector< shared_ptr<Node> > nodeList,
+void doSpickerCutoff(int totalNodes, const vector< vector<float> > &normScores,
+                     const vector< shared_ptr<Node> > &nodeList,
                      vector<shared_ptr<Cluster> > &clusterList,
                      int &totalClusters, float cutoff);
 
@@ -154,12 +163,35 @@ void doSpickerCutoff(int totalNodes, vector< vector<float> > normScores,
  * @param clusterList Vector of shared pointers to the Clusters
  * @param totalClusters Total number of clusters
  * @param kMeans the k number of means used in the clustering
+ * @param approxSamples Number of sampled references used to estimate the
+ *                     means in the update step (Cluster::calcApproxMean),
+ *                     0 to compute them exactly
  */
-void doKMeans(int totalNodes, vector< vector<float> > normScores,
-                     vector< shared_ptr<Node> > nodeList,
+void doKMeans(int totalNodes, const vector< vector<float> > &normScores,
+                     const vector< shared_ptr<Node> > &nodeList,
                      vector<shared_ptr<Cluster> > &clusterList,
-                     int &totalClusters, float kMeans);
+                     int &totalClusters, float kMeans, int approxSamples);
 
+/**
+ * Function for k-center clustering by farthest-point traversal
+ * (Gonzalez T.F., Theor Comput Sci. 1985;38:293-306), a 2-approximation
+ * of the smallest covering radius. Starting from the first element, the
+ * element farthest from all the centers is added as a new center until
+ * there are maxCenters centers or the covering radius is below the cutoff.
+ * Every center costs a single pass over its row of the distance matrix,
+ * which also assigns the elements to their closest center.
+ * @param totalNodes Total number of elements to cluster
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param nodeList Vector of shared pointers to the Nodes
+ * @param clusterList Vector of shared pointers to the Clusters
+ * @param totalClusters Total number of clusters
+ * @param cutoff Covering radius at which the traversal stops
+ * @param maxCenters Maximum number of centers, 0 for no limit
+ */
+void doKCenter(int totalNodes, const vector< vector<float> > &normScores,
+               vector< shared_ptr<Node> > &nodeList,
+               vector<shared_ptr<Cluster> > &clusterList,
+               int &totalClusters, float cutoff, int maxCenters);
 
 
 #endif
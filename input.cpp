@@ -15,6 +15,8 @@
 using namespace std;
 using namespace std::tr1;
 
+#include "input.h"
+
 void readInput (string inpFile, int &totalNodes,
                 vector<float> &rawScores, int measureType)
 {
@@ -48,9 +50,46 @@ void readInput (string inpFile, int &totalNodes,
     totalNodes=(int)sqrt((double)line);
 }
 
+/**
+ * Parses the cutoffs of a sweep, given as a comma-separated list or as
+ * lo:hi:count, count evenly spaced cutoffs from lo to hi
+ * @param text Argument of --cutoffs
+ * @param cutoffs Receives the cutoffs
+ * @return 1 if the argument is not valid, 0 otherwise
+ */
+static int parseCutoffs(const char *text, vector<float> &cutoffs)
+{
+    float low;
+    float high;
+    int count;
+    cutoffs.clear();
+    if (strchr(text,':'))
+    {
+        if (sscanf(text,"%f:%f:%d",&low,&high,&count)!=3 || count<1 ||
+            high<low)
+        {
+            return 1;
+        }
+        for (int c=0; c<count; c++)
+        {
+            cutoffs.push_back((count>1) ? low+(high-low)*c/(count-1) : low);
+        }
+        return 0;
+    }
+    const char *p=text;
+    while (*p)
+    {
+        char *end;
+        cutoffs.push_back(strtod(p,&end));
+        if (end==p || (*end && *end!=',')) return 1;
+        p = *end ? end+1 : end;
+    }
+    return cutoffs.empty();
+}
+
 int readParameters (int argc, char* argv[], bool &hMenu,
                       string &inpFile,int &clusterAlg,int &measureType,
-                      float &cutoff)
+                      float &cutoff, RunOptions &options)
 {
     /** Evaluate the parameters given by the user */
     for (int i = 1; i < argc; i++)
@@ -59,6 +98,18 @@ int readParameters (int argc, char* argv[], bool &hMenu,
         {
             hMenu=true;
         }
+        if (!strcmp("--benchmark", argv[i]))
+        {
+            options.benchmark=true;
+        }
+        if (!strcmp("--medoid-silhouette", argv[i]))
+        {
+            options.medoidSilhouette=true;
+        }
+        if (!strcmp("--auto-cutoff", argv[i]))
+        {
+            options.autoCutoff=true;
+        }
         if (i + 1 != argc)
         { // Check that we haven't finished parsing already
             if (!strcmp("-f", argv[i]))
@@ -77,6 +128,112 @@ int readParameters (int argc, char* argv[], bool &hMenu,
             {
                    cutoff = atof(argv[i + 1]);
             }
+            else if (!strcmp("--samples", argv[i]))
+            {
+                options.samples = atoi(argv[i + 1]);
+            }
+            else if (!strcmp("--sample-size", argv[i]))
+            {
+                options.sampleSize = atoi(argv[i + 1]);
+            }
+            else if (!strcmp("--state", argv[i]))
+            {
+                options.stateFile = argv[i + 1];
+            }
+            else if (!strcmp("--batch", argv[i]))
+            {
+                options.batchSize = atoi(argv[i + 1]);
+            }
+            else if (!strcmp("--reservoir", argv[i]))
+            {
+                options.reservoirSize = atoi(argv[i + 1]);
+            }
+            else if (!strcmp("--max-centers", argv[i]))
+            {
+                options.maxCenters = atoi(argv[i + 1]);
+            }
+            else if (!strcmp("--approx-medoid", argv[i]))
+            {
+                options.approxSamples = atoi(argv[i + 1]);
+            }
+            else if (!strcmp("--silhouette-tol", argv[i]))
+            {
+                options.silhouetteTol = atof(argv[i + 1]);
+            }
+            else if (!strcmp("--cluster-distances", argv[i]))
+            {
+                options.distanceFile = argv[i + 1];
+            }
+            else if (!strcmp("--cluster-distances-format", argv[i]))
+            {
+                if (strcmp("tsv",argv[i + 1]) && strcmp("bin",argv[i + 1]))
+                {
+                    printf("Error: invalid distance format, use tsv or bin\n");
+                    return 1;
+                }
+                options.binaryDistances = !strcmp("bin",argv[i + 1]);
+            }
+            else if (!strcmp("--out-format", argv[i]))
+            {
+                if (!strcmp("text",argv[i + 1]))
+                {
+                    options.outFormat = 0;
+                }
+                else if (!strcmp("bin",argv[i + 1]))
+                {
+                    options.outFormat = 1;
+                }
+                else if (!strcmp("json",argv[i + 1]))
+                {
+                    options.outFormat = 2;
+                }
+                else if (!strcmp("tsv",argv[i + 1]))
+                {
+                    options.outFormat = 3;
+                }
+                else
+                {
+                    printf("Error: invalid output format, use text, bin, json "
+                           "or tsv\n");
+                    return 1;
+                }
+            }
+            else if (!strcmp("--out", argv[i]))
+            {
+                options.outFile = argv[i + 1];
+            }
+            else if (!strcmp("--cutoffs", argv[i]))
+            {
+                if (parseCutoffs(argv[i + 1],options.cutoffs))
+                {
+                    printf("Error: invalid cutoffs, use --cutoffs c1,c2,... "
+                           "or --cutoffs lo:hi:count\n");
+                    return 1;
+                }
+            }
+            else if (!strcmp("--max-evals", argv[i]))
+            {
+                options.maxEvals = atoi(argv[i + 1]);
+            }
+            else if (!strcmp("--num-clusters", argv[i]))
+            {
+                options.numClusters = atoi(argv[i + 1]);
+                if (options.numClusters<1)
+                {
+                    printf("Error: invalid number of clusters\n");
+                    return 1;
+                }
+            }
+            else if (!strcmp("--k-range", argv[i]))
+            {
+                if (sscanf(argv[i + 1],"%d:%d",&options.kLow,
+                           &options.kHigh)!=2 ||
+                    options.kLow<1 || options.kHigh<options.kLow)
+                {
+                    printf("Error: invalid k range, use --k-range lo:hi\n");
+                    return 1;
+                }
+            }
         }
     }
 
@@ -86,19 +243,52 @@ int readParameters (int argc, char* argv[], bool &hMenu,
         //showHelp();
         return 1;
     }
-    if ( clusterAlg>4 && clusterAlg<0)
+    if ( clusterAlg>7 || clusterAlg<0)
     {
         printf ("Input Error: invalid choice of clustering algorithm\n");
         return 1;
     }
+    if (!options.cutoffs.empty() && (clusterAlg==6 || options.kLow>0))
+    {
+        printf("Error: a cutoff sweep cannot use the streaming k-medoids or "
+               "a k sweep\n");
+        return 1;
+    }
+    if (options.autoCutoff && (!options.cutoffs.empty() || options.kLow>0
+                               || clusterAlg==2 || clusterAlg==5 ||
+                               clusterAlg==6 || options.maxEvals<1))
+    {
+        printf("Error: --auto-cutoff needs an algorithm with a distance "
+               "cutoff, no other sweep and --max-evals of at least 1\n");
+        return 1;
+    }
+    if (options.numClusters>0 && ((clusterAlg!=0 && clusterAlg!=1) ||
+                                  !options.cutoffs.empty() ||
+                                  options.autoCutoff || options.kLow>0))
+    {
+        printf("Error: --num-clusters needs single linkage or SPICKER and "
+               "no other sweep\n");
+        return 1;
+    }
+    if (options.outFormat==1 && options.outFile.empty())
+    {
+        printf("Error: --out-format bin needs an output file, use --out\n");
+        return 1;
+    }
     if (measureType<0 || measureType>1)
     {
         printf("Error: invalid choice of measure type\n");
         return 1;
     }
-    if ( (measureType==1) && (clusterAlg!=2))
+    if ( (measureType==1) && (clusterAlg!=2) && (clusterAlg!=5)
+         && (clusterAlg!=6))
     {
         cutoff=1-cutoff;
+        options.similarities=true;
+        for (int c=0; c<options.cutoffs.size(); c++)
+        {
+            options.cutoffs[c]=1-options.cutoffs[c];
+        }
         //cutoff=((1.0/cutoff)-1.0);
     }
     return 0;
@@ -8,6 +8,49 @@
 #ifndef INPUT_H
 #define INPUT_H
 
+/**
+ * @struct RunOptions
+ * Holds the optional parameters that only some of the clustering
+ * algorithms use. The constructor sets the defaults.
+ */
+struct RunOptions
+{
+    int samples;        // Number of samples drawn by CLARA
+    int sampleSize;     // Elements per CLARA sample, 0 for 40+2k
+    string stateFile;   // State kept between streaming k-medoid runs
+    int batchSize;      // New elements between streaming swap phases
+    int reservoirSize;  // Members sampled for each streaming medoid
+    int kLow;           // Smallest k of a k sweep, 0 for no sweep
+    int kHigh;          // Largest k of a k sweep
+    int maxCenters;     // Maximum number of k-center centers, 0 for no limit
+    int approxSamples;  // References sampled for approximate k-means
+                        // means, 0 for exact means
+    bool benchmark;     // Report timings and allocations on stderr
+    bool medoidSilhouette; // Report the simplified, medoid-based silhouette
+    float silhouetteTol;   // Half width of the confidence interval of a
+                           // sampled silhouette, 0 for the exact one
+    string distanceFile;   // Output file of the distances between clusters
+    bool binaryDistances;  // Write them in binary instead of TSV
+    int outFormat;         // Cluster report as text (0), binary (1),
+                           // JSON lines (2) or TSV (3)
+    string outFile;        // File of the report, stdout if empty and
+                           // not binary
+    vector<float> cutoffs; // Cutoffs of a cutoff sweep, empty for one run
+    bool autoCutoff;       // Search the cutoff with the best silhouette
+    int maxEvals;          // Cutoffs evaluated by that search
+    int numClusters;       // Clusters wanted instead of a cutoff, 0 to use
+                           // the cutoff
+    bool similarities;     // Cutoffs given as similarities, applied as 1-c
+
+    RunOptions() : samples(5), sampleSize(0), batchSize(1000),
+                   reservoirSize(64), kLow(0), kHigh(0), maxCenters(0),
+                   approxSamples(0), benchmark(false),
+                   medoidSilhouette(false), silhouetteTol(0),
+                   binaryDistances(false), outFormat(0),
+                   autoCutoff(false), maxEvals(24), numClusters(0),
+                   similarities(false) {};
+};
+
 /**
  * Reads pairwise distances from a formatted file and
  * adds them to the rawScores vector. It determines how many elements are
@@ -33,10 +76,11 @@ void readInput (string inpFile, int &totalNodes, vector<float> &rawScores,
  * @param measureType Int to hold the choice of measure
  *                   (distances/similarities)
  * @param cutoff Float to hold the value of the cutoff  for clustering
+ * @param options RunOptions to hold the algorithm-specific parameters
  * @return 0 if the program can continue, 1 otherwise
  */
 int readParameters (int argc, char* argv[], bool &hMenu,
                       string &inpFile,int &clusterAlg,int &measureType,
-                      float &cutoff);
+                      float &cutoff, RunOptions &options);
 
 #endif
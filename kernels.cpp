@@ -0,0 +1,168 @@
+/**
+ * @file kernels.cpp
+ * @brief Implementation of the distance-matrix kernels
+ *
+ * Implements the reductions over the blocks of the distance matrix that the
+ * cluster statistics, the merge checks and the silhouette are computed from
+ */
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+#include "kernels.h"
+
+
+/**
+ * Reduces one row already gathered into contiguous memory
+ */
+static inline void reduceRow(const float *row, int m,
+                             float &rowSum, float &rowMax)
+{
+    float sum=0;
+    float largest=0;
+    #pragma omp simd reduction(+:sum) reduction(max:largest)
+    for (int j=0;j<m;j++)
+    {
+        sum+=row[j];
+        largest = (row[j] > largest) ? row[j] : largest;
+    }
+    rowSum=sum;
+    rowMax=largest;
+}
+
+void reduceMemberRows(const vector< vector<float> > &normScores,
+                      const vector<int> &ids, float *rowSums, float *rowMax)
+{
+    const int parallelThreshold=2048;   // Members above which the rows are
+                                        // tiled and reduced in parallel
+    const int tileFloats=4096;          // Tile buffer size, fits in L1
+    int m=ids.size();
+    if (m==0) return;
+    const int *cols=&ids[0];
+
+    if (m<parallelThreshold)
+    {
+        for (int i=0;i<m;i++)
+        {
+            const float *row=&normScores[ids[i]][0];
+            float sum=0;
+            float largest=0;
+            #pragma omp simd reduction(+:sum) reduction(max:largest)
+            for (int j=0;j<m;j++)
+            {
+                float d=row[cols[j]];
+                sum+=d;
+                largest = (d > largest) ? d : largest;
+            }
+            rowSums[i]=sum;
+            rowMax[i]=largest;
+        }
+        return;
+    }
+
+    vector<int> sorted(ids);    // Columns in memory order for the gathers
+    sort(sorted.begin(),sorted.end());
+    const int *sortedCols=&sorted[0];
+    #pragma omp parallel
+    {
+        vector<float> tile(tileFloats);  // Gathered chunk of a row
+        #pragma omp for schedule(dynamic,16)
+        for (int i=0;i<m;i++)
+        {
+            const float *row=&normScores[ids[i]][0];
+            float sum=0;
+            float largest=0;
+            for (int first=0;first<m;first+=tileFloats)
+            {
+                int n= (m-first < tileFloats) ? m-first : tileFloats;
+                for (int j=0;j<n;j++) tile[j]=row[sortedCols[first+j]];
+                float chunkSum;
+                float chunkMax;
+                reduceRow(&tile[0],n,chunkSum,chunkMax);
+                sum+=chunkSum;
+                largest = (chunkMax > largest) ? chunkMax : largest;
+            }
+            rowSums[i]=sum;
+            rowMax[i]=largest;
+        }
+    }
+}
+
+bool reduceCrossBlock(const vector< vector<float> > &normScores,
+                      const vector<int> &idsA, const vector<int> &idsB,
+                      float stopAt, CrossBlock &block)
+{
+    int mA=idsA.size();
+    int mB=idsB.size();
+
+    /* Columns in memory order, remembering where each one goes */
+    vector<pair<int,int> > &order=block.order;
+    order.resize(mB);
+    for (int j=0;j<mB;j++) order[j]=make_pair(idsB[j],j);
+    sort(order.begin(),order.end());
+    block.cols.resize(mB);
+    block.colPos.resize(mB);
+    for (int j=0;j<mB;j++)
+    {
+        block.cols[j]=order[j].first;
+        block.colPos[j]=order[j].second;
+    }
+    block.colSums.assign(mB,0);
+    block.colMax.assign(mB,0);
+    block.rowSumsA.resize(mA);
+    block.rowMaxA.resize(mA);
+
+    block.minDistance=0;
+    block.maxDistance=0;
+    block.distanceSum=0;
+    float minDistance=std::numeric_limits<float>::max();
+    bool complete=true;
+    const int *cols= mB>0 ? &block.cols[0] : 0;
+    float *colSums= mB>0 ? &block.colSums[0] : 0;
+    float *colMax= mB>0 ? &block.colMax[0] : 0;
+    for (int i=0;i<mA && mB>0;i++)
+    {
+        const float *row=&normScores[idsA[i]][0];
+        if (i+1<mA) __builtin_prefetch(&normScores[idsA[i+1]][cols[0]]);
+        float rowSum=0;
+        float rowMax=0;
+        float rowMin=std::numeric_limits<float>::max();
+        #pragma omp simd reduction(+:rowSum) reduction(max:rowMax) \
+                         reduction(min:rowMin)
+        for (int j=0;j<mB;j++)
+        {
+            float d=row[cols[j]];
+            rowSum+=d;
+            rowMax = (d>rowMax) ? d : rowMax;
+            rowMin = (d<rowMin) ? d : rowMin;
+            colSums[j]+=d;
+            colMax[j] = (d>colMax[j]) ? d : colMax[j];
+        }
+        block.rowSumsA[i]=rowSum;
+        block.rowMaxA[i]=rowMax;
+        block.distanceSum+=rowSum;
+        block.maxDistance = (rowMax>block.maxDistance) ?
+                            rowMax : block.maxDistance;
+        minDistance = (rowMin<minDistance) ? rowMin : minDistance;
+        if (rowMax>=stopAt)
+        {
+            complete=false;     // Some distance reached stopAt
+            break;
+        }
+    }
+    block.minDistance= (mA>0 && mB>0) ? minDistance : 0;
+    if (!complete) return false;
+
+    /* Back to the order of idsB */
+    block.rowSumsB.resize(mB);
+    block.rowMaxB.resize(mB);
+    for (int j=0;j<mB;j++)
+    {
+        block.rowSumsB[block.colPos[j]]=block.colSums[j];
+        block.rowMaxB[block.colPos[j]]=block.colMax[j];
+    }
+    return true;
+}
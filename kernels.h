@@ -0,0 +1,74 @@
+/**
+ * @file kernels.h
+ * @brief Definition of the distance-matrix kernels
+ *
+ * Defines the kernels that reduce blocks of the distance matrix selected by
+ * lists of element identifiers, and the CrossBlock aggregates they fill
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+/**
+ * @struct CrossBlock
+ * Aggregates of the block of distances between the members of two clusters
+ * A and B. They are enough to update the statistics of the cluster that
+ * results from merging A and B without scanning its whole distance block.
+ * Reusing one CrossBlock across scans reuses its buffers.
+ */
+struct CrossBlock
+{
+    float minDistance;          // Smallest distance between A and B
+    float maxDistance;          // Largest distance between A and B
+    double distanceSum;         // Sum of the distances between A and B
+    vector<float> rowSumsA;     // Sum of distances from each member of A to B
+    vector<float> rowMaxA;      // Largest distance from each member of A to B
+    vector<float> rowSumsB;     // Sum of distances from each member of B to A
+    vector<float> rowMaxB;      // Largest distance from each member of B to A
+    vector<int> idsA;           // Members of A
+    vector<int> idsB;           // Members of B
+    vector<pair<int,int> > order; // Scratch: members of B and their position
+    vector<int> cols;           // Scratch: members of B in memory order
+    vector<int> colPos;         // Scratch: position in idsB of each column
+    vector<float> colSums;      // Scratch: column sums in memory order
+    vector<float> colMax;       // Scratch: column maxima in memory order
+};
+
+/**
+ * Computes, for every member of a set of elements, the sum of and the largest
+ * of its distances to all the members (itself included). Small sets are
+ * reduced row by row. Above a size threshold the rows are split among the
+ * threads, and each row is gathered in column order, chunk by chunk, into a
+ * small contiguous tile that is reduced with a vectorized loop. The O(m^2)
+ * scan dominates the run for such clusters.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param ids Identifiers of the members
+ * @param rowSums Array of ids.size() floats that receives the row sums
+ * @param rowMax Array of ids.size() floats that receives the row maxima
+ */
+void reduceMemberRows(const vector< vector<float> > &normScores,
+                      const vector<int> &ids, float *rowSums, float *rowMax);
+
+/**
+ * Reduces the block of distances between two lists of elements A and B:
+ * smallest, largest and total distance, and the sum and maximum of every
+ * row (member of A) and column (member of B). The members of B are visited
+ * in memory order so that every row is read in one forward sweep, the next
+ * row is prefetched, and the inner loop is vectorized. The scan stops after
+ * the first row holding a distance of at least stopAt, for the checks that
+ * only need to know whether the whole block is below a cutoff.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param idsA Identifiers of the members of A, the rows of the block
+ * @param idsB Identifiers of the members of B, the columns of the block
+ * @param stopAt Distance that ends the scan, numeric_limits<float>::max()
+ *              to scan the whole block
+ * @param block CrossBlock that receives the aggregates, in the order of
+ *             idsA and idsB. Its idsA and idsB may be the ones passed.
+ * @return complete FALSE if the scan stopped early, in which case only
+ *                 maxDistance is meaningful
+ */
+bool reduceCrossBlock(const vector< vector<float> > &normScores,
+                      const vector<int> &idsA, const vector<int> &idsB,
+                      float stopAt, CrossBlock &block);
+
+#endif
@@ -0,0 +1,775 @@
+/**
+ * @file kmedoids.cpp
+ * @brief Implementation of functions for k-medoid clustering
+ *
+ * Implements the medoid assignment, the FasterPAM swap search and the
+ * CLARA sampling driver
+ */
+
+#include <tr1/memory>
+#include <vector>
+#include <queue>
+#include <limits>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "node.h"
+#include "cluster.h"
+#include "kernels.h"
+#include "arena.h"
+#include "cluster_table.h"
+#include "link.h"
+#include "link_comparator.h"
+#include "clustering.h"
+#include "kmedoids.h"
+#include "stats.h"
+#include <iostream>
+#include <fstream>
+
+
+using namespace std;
+using namespace std::tr1;
+
+
+double assignToMedoids(int totalNodes, const vector< vector<float> > &normScores,
+                       const vector<int> &medoids, vector<int> &labels)
+{
+    const int blockSize=4096;   // Elements per block, fits best[] in cache
+    int totalBlocks=(totalNodes+blockSize-1)/blockSize;
+    vector<float> best(totalNodes,std::numeric_limits<float>::max());
+    labels.assign(totalNodes,0);
+    double cost=0;
+
+    /* Every thread owns whole blocks of elements, so labels and best are
+       written without any synchronization */
+    #pragma omp parallel for schedule(static) reduction(+:cost)
+    for (int block=0; block<totalBlocks; block++)
+    {
+        int start=block*blockSize;
+        int end=(start+blockSize<totalNodes) ? start+blockSize : totalNodes;
+        float *b=&best[0];
+        int *l=&labels[0];
+        for (int k=0; k<medoids.size(); k++)
+        {
+            const float *row=&normScores[medoids[k]][0];
+            /* Branch-free minimum so that the loop is vectorized */
+            for (int i=start; i<end; i++)
+            {
+                bool closer = row[i] < b[i];
+                l[i] = closer ? k : l[i];
+                b[i] = closer ? row[i] : b[i];
+            }
+        }
+        for (int i=start; i<end; i++)
+        {
+            cost+=b[i];
+        }
+    }
+    return cost;
+}
+
+double estimateMedoid(const vector< vector<float> > &normScores,
+                      const vector<int> &ids, int samples, int incumbent,
+                      int &medoid)
+{
+    const float z=3;                // Width of the confidence bounds, in
+                                    // standard errors (about 99.9%)
+    const int maxCandidates=16;     // Members whose mean is computed exactly
+    int m=ids.size();
+    medoid=-1;
+    if (m==0) return 0;
+
+    /* Small clusters are cheaper to solve exactly */
+    if (samples<2 || m<=2*samples)
+    {
+        vector<float> rowSums(m);
+        vector<float> rowMax(m);
+        reduceMemberRows(normScores,ids,&rowSums[0],&rowMax[0]);
+        int best=0;
+        for (int i=1;i<m;i++) best = (rowSums[i]<rowSums[best]) ? i : best;
+        medoid=ids[best];
+        return 0;
+    }
+
+    /* Reference members drawn with replacement, in memory order */
+    vector<int> refs(samples);
+    for (int r=0;r<samples;r++) refs[r]=ids[rand()%m];
+    sort(refs.begin(),refs.end());
+
+    /* Estimate of the mean distance of every member and its standard
+       error, from its distances to the references */
+    vector<float> estimate(m);
+    vector<float> spread(m);
+    #pragma omp parallel for schedule(static)
+    for (int i=0;i<m;i++)
+    {
+        const float *row=&normScores[ids[i]][0];
+        float sum=0;
+        float sumSq=0;
+        #pragma omp simd reduction(+:sum,sumSq)
+        for (int r=0;r<samples;r++)
+        {
+            float d=row[refs[r]];
+            sum+=d;
+            sumSq+=d*d;
+        }
+        float mean=sum/samples;
+        float var=(sumSq-samples*mean*mean)/(samples-1);
+        estimate[i]=mean;
+        spread[i]=z*sqrt((var>0 ? var : 0)/samples);
+    }
+
+    /* Members whose lower bound is above the lowest upper bound are pruned,
+       the most promising of the rest are computed exactly */
+    float minUpper=estimate[0]+spread[0];
+    for (int i=1;i<m;i++)
+    {
+        float upper=estimate[i]+spread[i];
+        minUpper = (upper<minUpper) ? upper : minUpper;
+    }
+    vector<pair<float,int> > candidates;
+    for (int i=0;i<m;i++)
+    {
+        if (estimate[i]-spread[i]<=minUpper)
+        {
+            candidates.push_back(make_pair(estimate[i],i));
+        }
+    }
+    sort(candidates.begin(),candidates.end());
+    if (candidates.size()>maxCandidates) candidates.resize(maxCandidates);
+    vector<bool> exact(m,false);
+    for (int c=0;c<candidates.size();c++) exact[candidates[c].second]=true;
+    for (int i=0;i<m;i++)
+    {
+        if (ids[i]==incumbent && !exact[i])
+        {
+            candidates.push_back(make_pair(estimate[i],i));
+            exact[i]=true;
+        }
+    }
+
+    vector<double> means(candidates.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (int c=0;c<candidates.size();c++)
+    {
+        const float *row=&normScores[ids[candidates[c].second]][0];
+        double sum=0;
+        for (int j=0;j<m;j++) sum+=row[ids[j]];
+        means[c]=sum/m;
+    }
+    int best=0;
+    for (int c=1;c<candidates.size();c++)
+    {
+        bool better = means[c]<means[best] ||
+                      (means[c]==means[best] &&
+                       candidates[c].second<candidates[best].second);
+        best = better ? c : best;
+    }
+    medoid=ids[candidates[best].second];
+
+    /* The true medoid can only be better than the one found if it is among
+       the members not computed exactly, by at most the distance to their
+       lowest lower bound */
+    double error=0;
+    for (int i=0;i<m;i++)
+    {
+        if (exact[i]) continue;
+        double gap=means[best]-(estimate[i]-spread[i]);
+        error = (gap>error) ? gap : error;
+    }
+    return error;
+}
+
+/**
+ * Finds the closest and second closest medoid of every element
+ * @param rows Pointers to the rows of the distance matrix
+ * @param n Number of elements
+ * @param medoids Row numbers of the medoids
+ * @param nearest Position in medoids of the closest medoid
+ * @param dNearest Distance to the closest medoid
+ * @param dSecond Distance to the second closest medoid
+ */
+static void updateNearest(const vector<const float*> &rows, int n,
+                          const vector<int> &medoids, vector<int> &nearest,
+                          vector<float> &dNearest, vector<float> &dSecond)
+{
+    for (int o=0; o<n; o++)
+    {
+        float d1=std::numeric_limits<float>::max();
+        float d2=std::numeric_limits<float>::max();
+        int n1=0;
+        for (int m=0; m<medoids.size(); m++)
+        {
+            float d=rows[medoids[m]][o];
+            if (d<d1)
+            {
+                d2=d1;
+                d1=d;
+                n1=m;
+            }
+            else if (d<d2)
+            {
+                d2=d;
+            }
+        }
+        nearest[o]=n1;
+        dNearest[o]=d1;
+        dSecond[o]=d2;
+    }
+}
+
+/**
+ * Computes the increase of the total deviation caused by removing each
+ * medoid, when its elements move to their second closest medoid
+ * @param n Number of elements
+ * @param weights Weight of every element
+ * @param nearest Position in medoids of the closest medoid
+ * @param dNearest Distance to the closest medoid
+ * @param dSecond Distance to the second closest medoid
+ * @param removalLoss Loss of removing each medoid
+ */
+static void updateRemovalLoss(int n, const vector<float> &weights,
+                              const vector<int> &nearest,
+                              const vector<float> &dNearest,
+                              const vector<float> &dSecond,
+                              vector<double> &removalLoss)
+{
+    removalLoss.assign(removalLoss.size(),0);
+    for (int o=0; o<n; o++)
+    {
+        removalLoss[nearest[o]]+=weights[o]*(dSecond[o]-dNearest[o]);
+    }
+}
+
+double fasterPAM(const vector<const float*> &rows, int n,
+                 vector<int> &medoids, int maxIter)
+{
+    vector<float> weights(n,1);
+    return weightedFasterPAM(rows,n,weights,medoids,maxIter);
+}
+
+double weightedFasterPAM(const vector<const float*> &rows, int n,
+                         const vector<float> &weights, vector<int> &medoids,
+                         int maxIter)
+{
+    int k=medoids.size();
+    vector<int> nearest(n);
+    vector<float> dNearest(n);
+    vector<float> dSecond(n);
+    vector<bool> isMedoid(n,false);
+    vector<double> removalLoss(k);
+    vector<double> delta(k);
+
+    for (int m=0; m<k; m++)
+    {
+        isMedoid[medoids[m]]=true;
+    }
+    updateNearest(rows,n,medoids,nearest,dNearest,dSecond);
+    if (k==1)
+    {
+        /* Without a second medoid the removal loss is meaningless, a swap
+           simply replaces every distance with the one to the candidate */
+        dSecond=dNearest;
+    }
+    updateRemovalLoss(n,weights,nearest,dNearest,dSecond,removalLoss);
+
+    for (int iter=0; iter<maxIter && k>0; iter++)
+    {
+        int swaps=0;
+        for (int xc=0; xc<n; xc++)
+        {
+            if (isMedoid[xc]) continue;
+
+            delta=removalLoss;
+            double acc=0;
+            const float *row=rows[xc];
+            for (int o=0; o<n; o++)
+            {
+                float doj=row[o];
+                float w=weights[o];
+                if (doj<dNearest[o])
+                {
+                    acc+=w*(doj-dNearest[o]);
+                    delta[nearest[o]]+=w*(dNearest[o]-dSecond[o]);
+                }
+                else if (doj<dSecond[o] || k==1)
+                {
+                    delta[nearest[o]]+=w*(doj-dSecond[o]);
+                }
+            }
+
+            int bestMedoid=0;
+            for (int m=1; m<k; m++)
+            {
+                bestMedoid = (delta[m]<delta[bestMedoid]) ? m : bestMedoid;
+            }
+
+            if (delta[bestMedoid]+acc < -1e-6)
+            {
+                isMedoid[medoids[bestMedoid]]=false;
+                isMedoid[xc]=true;
+                medoids[bestMedoid]=xc;
+                updateNearest(rows,n,medoids,nearest,dNearest,dSecond);
+                if (k==1) dSecond=dNearest;
+                updateRemovalLoss(n,weights,nearest,dNearest,dSecond,removalLoss);
+                swaps++;
+            }
+        }
+        if (swaps==0) break;
+    }
+
+    double cost=0;
+    for (int o=0; o<n; o++)
+    {
+        cost+=weights[o]*dNearest[o];
+    }
+    return cost;
+}
+
+double claraMedoids(int totalNodes, const vector< vector<float> > &normScores,
+                    int k, int samples, int sampleSize, vector<int> &medoids)
+{
+    k = (k>totalNodes) ? totalNodes : k;
+    k = (k<1) ? 1 : k;
+    samples = (samples<1) ? 1 : samples;
+    sampleSize = (sampleSize<=0) ? 40+2*k : sampleSize;
+    sampleSize = (sampleSize<k) ? k : sampleSize;
+    sampleSize = (sampleSize>totalNodes) ? totalNodes : sampleSize;
+
+    /* Draw all the samples before going parallel, rand() is not reentrant */
+    vector< vector<int> > sampleIds(samples);
+    vector<int> pool(totalNodes);
+    for (int i=0; i<totalNodes; i++) pool[i]=i;
+    for (int s=0; s<samples; s++)
+    {
+        for (int i=0; i<sampleSize; i++)   // Partial Fisher-Yates shuffle
+        {
+            int j= i + rand() % (totalNodes-i);
+            int tmp=pool[i];
+            pool[i]=pool[j];
+            pool[j]=tmp;
+        }
+        sampleIds[s].assign(pool.begin(),pool.begin()+sampleSize);
+    }
+
+    vector< vector<int> > sampleMedoids(samples);
+    vector<double> sampleCost(samples);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int s=0; s<samples; s++)
+    {
+        /* Copy the sample distance matrix, O(sampleSize^2) */
+        const vector<int> &ids=sampleIds[s];
+        vector<float> subMatrix(sampleSize*sampleSize);
+        vector<const float*> rows(sampleSize);
+        for (int i=0; i<sampleSize; i++)
+        {
+            const vector<float> &fullRow=normScores[ids[i]];
+            for (int j=0; j<sampleSize; j++)
+            {
+                subMatrix[i*sampleSize+j]=fullRow[ids[j]];
+            }
+            rows[i]=&subMatrix[i*sampleSize];
+        }
+
+        /* The sample is already shuffled, its first k elements are a
+           random initialization */
+        vector<int> localMedoids(k);
+        for (int m=0; m<k; m++) localMedoids[m]=m;
+        fasterPAM(rows,sampleSize,localMedoids,100);
+
+        for (int m=0; m<k; m++) localMedoids[m]=ids[localMedoids[m]];
+        vector<int> labels;
+        sampleCost[s]=assignToMedoids(totalNodes,normScores,localMedoids,
+                                      labels);
+        sampleMedoids[s]=localMedoids;
+    }
+
+    int bestSample=0;
+    for (int s=1; s<samples; s++)
+    {
+        bestSample = (sampleCost[s]<sampleCost[bestSample]) ? s : bestSample;
+    }
+    medoids=sampleMedoids[bestSample];
+    return sampleCost[bestSample];
+}
+
+void doClara(int totalNodes, const vector< vector<float> > &normScores,
+             vector< shared_ptr<Node> > &nodeList,
+             vector<shared_ptr<Cluster> > &clusterList,
+             int &totalClusters, int k, int samples, int sampleSize)
+{
+    vector<int> medoids;
+    vector<int> labels;
+    claraMedoids(totalNodes,normScores,k,samples,sampleSize,medoids);
+    assignToMedoids(totalNodes,normScores,medoids,labels);
+    makeClustersFromLabels(labels,medoids.size(),nodeList,clusterList,
+                           totalClusters);
+}
+
+/**
+ * @struct StreamState
+ * State of the streaming k-medoid clustering that is kept between runs
+ */
+struct StreamState
+{
+    vector<int> medoids;                // Identifiers of the medoids
+    vector<int> labels;                 // Medoid of every element seen
+    vector< vector<int> > reservoirs;   // Sampled members of each medoid
+    vector<long> memberCount;           // Members offered to each reservoir
+};
+
+/**
+ * Reads the streaming state from a file, and checks it against the input:
+ * at most totalNodes elements seen, medoids among the input elements, labels
+ * below k and reservoirs made of elements seen
+ * @param stateFile Name of the state file
+ * @param totalNodes Number of elements of the input
+ * @param state StreamState to fill
+ * @return true if a valid state was read
+ */
+static bool readStreamState(const string &stateFile, int totalNodes,
+                            StreamState &state)
+{
+    ifstream infile(stateFile.c_str());
+    string header;
+    int k;
+    int seen;
+    if (!(infile >> header >> k >> seen) || header!="kmedoids-state")
+    {
+        return false;
+    }
+    if (k<1 || k>totalNodes || seen<0 || seen>totalNodes)
+    {
+        printf("Warning: state file does not match the input, "
+               "starting a new clustering\n");
+        return false;
+    }
+    state.medoids.resize(k);
+    state.labels.resize(seen);
+    state.reservoirs.assign(k,vector<int>());
+    state.memberCount.resize(k);
+    bool valid=true;
+    for (int m=0; m<k && valid; m++)
+    {
+        valid = (infile >> state.medoids[m]) && state.medoids[m]>=0 &&
+                state.medoids[m]<totalNodes;
+    }
+    for (int i=0; i<seen && valid; i++)
+    {
+        valid = (infile >> state.labels[i]) && state.labels[i]>=0 &&
+                state.labels[i]<k;
+    }
+    for (int m=0; m<k && valid; m++)
+    {
+        int size;
+        valid = (infile >> state.memberCount[m] >> size) &&
+                state.memberCount[m]>=0 && size>=0 && size<=seen;
+        if (!valid) break;
+        state.reservoirs[m].resize(size);
+        for (int j=0; j<size && valid; j++)
+        {
+            valid = (infile >> state.reservoirs[m][j]) &&
+                    state.reservoirs[m][j]>=0 && state.reservoirs[m][j]<seen;
+        }
+    }
+    if (!valid)
+    {
+        printf("Warning: state file is truncated or does not match the "
+               "input, starting a new clustering\n");
+    }
+    return valid;
+}
+
+/**
+ * Writes the streaming state to a file
+ * @param stateFile Name of the state file
+ * @param state StreamState to write
+ */
+static void writeStreamState(const string &stateFile, const StreamState &state)
+{
+    ofstream outfile(stateFile.c_str());
+    int k=state.medoids.size();
+    outfile << "kmedoids-state " << k << " " << state.labels.size() << "\n";
+    for (int m=0; m<k; m++) outfile << state.medoids[m] << " ";
+    outfile << "\n";
+    for (int i=0; i<state.labels.size(); i++) outfile << state.labels[i] << " ";
+    outfile << "\n";
+    for (int m=0; m<k; m++)
+    {
+        outfile << state.memberCount[m] << " " << state.reservoirs[m].size();
+        for (int j=0; j<state.reservoirs[m].size(); j++)
+        {
+            outfile << " " << state.reservoirs[m][j];
+        }
+        outfile << "\n";
+    }
+}
+
+/**
+ * Small-batch swap phase: runs a few weighted FasterPAM passes on the
+ * medoids and the reservoir samples of all the clusters, so that a medoid
+ * can be replaced by any of the sampled members. The members of a cluster
+ * are shared evenly by its samples and its medoid, so that every cluster
+ * weighs as much as its number of members.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param state StreamState whose medoids are updated
+ */
+static void streamSwapPhase(const vector< vector<float> > &normScores,
+                            StreamState &state)
+{
+    int k=state.medoids.size();
+    vector<int> candidates(state.medoids);
+    vector<float> weights(k,0);
+    for (int m=0; m<k; m++)
+    {
+        const vector<int> &reservoir=state.reservoirs[m];
+        bool sampled=false;     // The medoid is in its own reservoir
+        for (int j=0; j<reservoir.size(); j++)
+        {
+            sampled = sampled || (reservoir[j]==state.medoids[m]);
+        }
+        float share=(float)state.memberCount[m]/
+                    (reservoir.size()+(sampled ? 0 : 1));
+        weights[m]+=share;
+        for (int j=0; j<reservoir.size(); j++)
+        {
+            int id=reservoir[j];
+            int c=0;
+            while (c<candidates.size() && candidates[c]!=id) c++;
+            if (c==candidates.size())
+            {
+                candidates.push_back(id);
+                weights.push_back(0);
+            }
+            if (id!=state.medoids[m]) weights[c]+=share;
+        }
+    }
+
+    int n=candidates.size();
+    vector<float> subMatrix(n*n);
+    vector<const float*> rows(n);
+    for (int i=0; i<n; i++)
+    {
+        const vector<float> &fullRow=normScores[candidates[i]];
+        for (int j=0; j<n; j++)
+        {
+            subMatrix[i*n+j]=fullRow[candidates[j]];
+        }
+        rows[i]=&subMatrix[i*n];
+    }
+
+    /* The medoids are the first k candidates */
+    vector<int> localMedoids(k);
+    for (int m=0; m<k; m++) localMedoids[m]=m;
+    weightedFasterPAM(rows,n,weights,localMedoids,2);
+    for (int m=0; m<k; m++) state.medoids[m]=candidates[localMedoids[m]];
+}
+
+/**
+ * Counts an element as a member of a medoid and offers it to the reservoir
+ * of the medoid (reservoir sampling)
+ * @param state StreamState to update
+ * @param m Position of the medoid
+ * @param i Identifier of the element
+ * @param reservoirSize Number of members sampled for each medoid
+ */
+static void offerToReservoir(StreamState &state, int m, int i,
+                             int reservoirSize)
+{
+    vector<int> &reservoir=state.reservoirs[m];
+    long count=++state.memberCount[m];
+    if (reservoir.size()<reservoirSize)
+    {
+        reservoir.push_back(i);
+    }
+    else
+    {
+        long j=rand() % count;
+        if (j<reservoirSize) reservoir[j]=i;
+    }
+}
+
+void doStreamingKMedoids(int totalNodes,
+                         const vector< vector<float> > &normScores,
+                         vector< shared_ptr<Node> > &nodeList,
+                         vector<shared_ptr<Cluster> > &clusterList,
+                         int &totalClusters, int k, const string &stateFile,
+                         int batchSize, int reservoirSize)
+{
+    StreamState state;
+    bool resumed = !stateFile.empty() &&
+                   readStreamState(stateFile,totalNodes,state);
+    if (resumed && state.medoids.size()!=k)
+    {
+        printf("Warning: using k=%d from the state file\n",
+               (int)state.medoids.size());
+    }
+    batchSize = (batchSize<1) ? 1 : batchSize;
+    reservoirSize = (reservoirSize<1) ? 1 : reservoirSize;
+    if (!resumed)
+    {
+        /* Bootstrap with CLARA on the elements available now, and keep its
+           assignment: they are all seen, with nothing left to stream */
+        state=StreamState();
+        claraMedoids(totalNodes,normScores,k,5,0,state.medoids);
+        k=state.medoids.size();
+        assignToMedoids(totalNodes,normScores,state.medoids,state.labels);
+        state.reservoirs.assign(k,vector<int>());
+        state.memberCount.assign(k,0);
+        for (int i=0; i<totalNodes; i++)
+        {
+            offerToReservoir(state,state.labels[i],i,reservoirSize);
+        }
+    }
+    k=state.medoids.size();
+
+    /* Only the elements that were not seen in previous runs are assigned */
+    int seen=state.labels.size();
+    state.labels.resize(totalNodes);
+    for (int i=seen; i<totalNodes; i++)
+    {
+        const vector<float> &row=normScores[i];
+        int closest=0;
+        for (int m=1; m<k; m++)
+        {
+            closest = (row[state.medoids[m]]<row[state.medoids[closest]]) ?
+                      m : closest;
+        }
+        state.labels[i]=closest;
+        offerToReservoir(state,closest,i,reservoirSize);
+
+        if ((i-seen+1)%batchSize==0 || i==totalNodes-1)
+        {
+            streamSwapPhase(normScores,state);
+        }
+    }
+
+    if (!stateFile.empty())
+    {
+        writeStreamState(stateFile,state);
+    }
+    makeClustersFromLabels(state.labels,k,nodeList,clusterList,totalClusters);
+}
+
+/**
+ * Greedy BUILD step: adds the element that lowers the total deviation the
+ * most as a new medoid. With no medoids it adds the element with the
+ * smallest sum of distances. The candidates are evaluated in parallel.
+ * @param rows Pointers to the rows of a square distance matrix
+ * @param n Number of rows (elements) in the matrix
+ * @param medoids Row numbers of the medoids, the new one is appended
+ */
+static void buildAddMedoid(const vector<const float*> &rows, int n,
+                           vector<int> &medoids)
+{
+    vector<float> dNearest(n,std::numeric_limits<float>::max());
+    vector<bool> isMedoid(n,false);
+    for (int m=0; m<medoids.size(); m++)
+    {
+        const float *row=rows[medoids[m]];
+        for (int o=0; o<n; o++)
+        {
+            dNearest[o] = (row[o]<dNearest[o]) ? row[o] : dNearest[o];
+        }
+        isMedoid[medoids[m]]=true;
+    }
+
+    /* Change of the total deviation if each candidate is added */
+    vector<double> change(n,std::numeric_limits<double>::max());
+    #pragma omp parallel for schedule(static)
+    for (int c=0; c<n; c++)
+    {
+        if (isMedoid[c]) continue;
+        const float *row=rows[c];
+        double sum=0;
+        if (medoids.empty())
+        {
+            for (int o=0; o<n; o++) sum+=row[o];
+        }
+        else
+        {
+            for (int o=0; o<n; o++)
+            {
+                float d=row[o]-dNearest[o];
+                sum += (d<0) ? d : 0;
+            }
+        }
+        change[c]=sum;
+    }
+
+    int best=-1;
+    for (int c=0; c<n; c++)
+    {
+        if (isMedoid[c]) continue;
+        best = (best<0 || change[c]<change[best]) ? c : best;
+    }
+    if (best>=0) medoids.push_back(best);
+}
+
+int doKSweep(int totalNodes, const vector< vector<float> > &normScores,
+             vector< shared_ptr<Node> > &nodeList,
+             vector<shared_ptr<Cluster> > &clusterList,
+             int &totalClusters, int kLow, int kHigh)
+{
+    kHigh = (kHigh>totalNodes) ? totalNodes : kHigh;
+    kLow = (kLow<1) ? 1 : kLow;
+    kLow = (kLow>kHigh) ? kHigh : kLow;
+    int totalK=kHigh-kLow+1;
+
+    vector<const float*> rows(totalNodes);
+    for (int i=0; i<totalNodes; i++)
+    {
+        rows[i]=&normScores[i][0];
+    }
+
+    /* Full solution for the smallest k */
+    vector<int> medoids;
+    while (medoids.size()<kLow)
+    {
+        buildAddMedoid(rows,totalNodes,medoids);
+    }
+    fasterPAM(rows,totalNodes,medoids,100);
+
+    /* Every next k is warm-started from the previous solution */
+    vector< vector<int> > sweepLabels(totalK);
+    vector<double> sweepCost(totalK);
+    vector<double> sweepSilhouette(totalK);
+    for (int k=kLow; k<=kHigh; k++)
+    {
+        if (k>kLow)
+        {
+            buildAddMedoid(rows,totalNodes,medoids);
+            fasterPAM(rows,totalNodes,medoids,2);
+        }
+        sweepCost[k-kLow]=assignToMedoids(totalNodes,normScores,medoids,
+                                          sweepLabels[k-kLow]);
+    }
+
+    /* The silhouettes of the different k are independent, one per thread
+       when there are enough of them for all the threads; otherwise every
+       calcSilhouette spreads its elements over all of them */
+    int threads=1;
+#ifdef _OPENMP
+    threads=omp_get_max_threads();
+#endif
+    #pragma omp parallel for schedule(dynamic) if(totalK>=threads)
+    for (int s=0; s<totalK; s++)
+    {
+        sweepSilhouette[s]=calcSilhouette(normScores,sweepLabels[s],kLow+s);
+    }
+
+    int best=0;
+    for (int s=0; s<totalK; s++)
+    {
+        printf("k %d Cost %f AvSil %f\n",kLow+s,sweepCost[s],
+               sweepSilhouette[s]);
+        best = (sweepSilhouette[s]>sweepSilhouette[best]) ? s : best;
+    }
+    makeClustersFromLabels(sweepLabels[best],kLow+best,nodeList,clusterList,
+                           totalClusters);
+    return kLow+best;
+}
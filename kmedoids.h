@@ -0,0 +1,169 @@
+/**
+ * @file kmedoids.h
+ * @brief Definition of functions for k-medoid clustering
+ *
+ * Defines the FasterPAM swap search, the assignment of elements to a set of
+ * medoids, the sampled medoid estimate and the CLARA sampling driver built
+ * on top of them
+ */
+
+#ifndef KMEDOIDS_H
+#define KMEDOIDS_H
+
+/**
+ * Assigns every element to its closest medoid. The distance matrix is
+ * symmetric, so the medoid rows are scanned instead of the element rows:
+ * each medoid contributes one contiguous pass over its row. The elements
+ * are split in blocks that are processed in parallel.
+ * Ties are resolved in favour of the medoid that comes first.
+ * @param totalNodes Total number of elements to assign
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param medoids Identifiers of the medoid elements
+ * @param labels Index (in medoids) of the closest medoid of each element
+ * @return cost Sum of the distances from each element to its medoid
+ */
+double assignToMedoids(int totalNodes, const vector< vector<float> > &normScores,
+                       const vector<int> &medoids, vector<int> &labels);
+
+/**
+ * Finds an approximate medoid (member with the smallest mean distance to the
+ * other members) in O(m*samples) time instead of O(m^2), in the spirit of
+ * trimed (Newling J., Fleuret F., AISTATS 2017) and of the bandit medoid of
+ * Bagaria V. et al. (AISTATS 2018). The mean distance of every member is
+ * estimated from its distances to a random sample of references, members
+ * whose confidence interval lies above the best upper bound are pruned and
+ * a few of the remaining ones are computed exactly. Sets of at most
+ * 2*samples members are solved exactly.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param ids Identifiers of the members
+ * @param samples Number of references drawn for the estimates
+ * @param incumbent Member always computed exactly, so that the result is
+ *                 never worse than it, -1 for none
+ * @param medoid Identifier of the medoid found, -1 if there are no members
+ * @return error Estimated bound on how much the mean distance of the medoid
+ *              found exceeds that of the true medoid, 0 if solved exactly
+ */
+double estimateMedoid(const vector< vector<float> > &normScores,
+                      const vector<int> &ids, int samples, int incumbent,
+                      int &medoid);
+
+/**
+ * FasterPAM k-medoid search
+ * (Schubert E., Rousseeuw P.J., Information Systems 2021;101:101804)
+ * Starting from the given medoids, eagerly applies the first swap of a
+ * medoid with a non-medoid that lowers the total deviation, until a whole
+ * pass over the candidates gives no improvement.
+ * @param rows Pointers to the rows of a square distance matrix
+ * @param n Number of rows (elements) in the matrix
+ * @param medoids Initial medoids, replaced by the final ones. Indices are
+ *               row numbers of the matrix
+ * @param maxIter Maximum number of passes over the candidates
+ * @return cost Total deviation of the final medoids
+ */
+double fasterPAM(const vector<const float*> &rows, int n,
+                 vector<int> &medoids, int maxIter);
+
+/**
+ * FasterPAM on weighted elements: the distance of every element to its
+ * medoid counts as many times as its weight in the total deviation, so that
+ * a sample can stand for the elements it was drawn from
+ * @param rows Pointers to the rows of a square distance matrix
+ * @param n Number of rows (elements) in the matrix
+ * @param weights Weight of every element
+ * @param medoids Initial medoids, replaced by the final ones. Indices are
+ *               row numbers of the matrix
+ * @param maxIter Maximum number of passes over the candidates
+ * @return cost Weighted total deviation of the final medoids
+ */
+double weightedFasterPAM(const vector<const float*> &rows, int n,
+                         const vector<float> &weights, vector<int> &medoids,
+                         int maxIter);
+
+/**
+ * Finds k medoids with CLARA: FasterPAM is run on several random samples of
+ * the elements and the medoids of the sample with the lowest total cost
+ * over all the elements are kept. The samples are drawn with rand() up
+ * front and then processed in parallel.
+ * @param totalNodes Total number of elements
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param k Number of medoids, clamped to [1,totalNodes]
+ * @param samples Number of random samples to draw
+ * @param sampleSize Number of elements in each sample, 0 selects the
+ *                  usual 40+2k
+ * @param medoids Identifiers of the medoids found
+ * @return cost Total cost of the medoids over all the elements
+ */
+double claraMedoids(int totalNodes, const vector< vector<float> > &normScores,
+                    int k, int samples, int sampleSize, vector<int> &medoids);
+
+/**
+ * Function for CLARA clustering (Kaufman L., Rousseeuw P.J., Finding Groups
+ * in Data, 1990). Runs FasterPAM on several random samples of the elements,
+ * assigns all the elements to the medoids found in each sample and keeps
+ * the medoids with the lowest total cost. The samples are processed in
+ * parallel and only the sample distance matrices are copied.
+ * @param totalNodes Total number of elements to cluster
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param nodeList Vector of shared pointers to the Nodes
+ * @param clusterList Vector of shared pointers to the Clusters
+ * @param totalClusters Total number of clusters
+ * @param k Number of medoids
+ * @param samples Number of random samples to draw
+ * @param sampleSize Number of elements in each sample, 0 selects the
+ *                  usual 40+2k
+ */
+void doClara(int totalNodes, const vector< vector<float> > &normScores,
+             vector< shared_ptr<Node> > &nodeList,
+             vector<shared_ptr<Cluster> > &clusterList,
+             int &totalClusters, int k, int samples, int sampleSize);
+
+/**
+ * Function for streaming k-medoid clustering of elements that arrive over
+ * time. The medoids, the labels of the elements already seen and a
+ * reservoir sample of the members of each medoid are kept in a state file.
+ * Elements with an identifier beyond the ones in the state are assigned to
+ * their closest medoid and offered to its reservoir, and after every batch
+ * a few FasterPAM swap passes over the reservoirs, each sample weighted by
+ * the members it stands for, update the medoids. The elements seen in
+ * previous runs keep their labels, so the work done is proportional to the
+ * number of new elements. Without a state the medoids and the labels of all
+ * the elements come from CLARA.
+ * @param totalNodes Total number of elements to cluster
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param nodeList Vector of shared pointers to the Nodes
+ * @param clusterList Vector of shared pointers to the Clusters
+ * @param totalClusters Total number of clusters
+ * @param k Number of medoids, ignored if a state is read
+ * @param stateFile Name of the file the state is read from and written to,
+ *                 empty to not keep any state
+ * @param batchSize Number of new elements between swap phases
+ * @param reservoirSize Number of members sampled for each medoid
+ */
+void doStreamingKMedoids(int totalNodes,
+                         const vector< vector<float> > &normScores,
+                         vector< shared_ptr<Node> > &nodeList,
+                         vector<shared_ptr<Cluster> > &clusterList,
+                         int &totalClusters, int k, const string &stateFile,
+                         int batchSize, int reservoirSize);
+
+/**
+ * Sweeps k over a range of values with warm-started k-medoid solutions.
+ * The smallest k is solved with greedy BUILD and FasterPAM; the solution for
+ * k+1 adds the best new medoid (BUILD step) to the solution for k and runs
+ * two FasterPAM passes. The cost and the silhouette of every k are printed,
+ * and the clustering with the largest silhouette is kept.
+ * @param totalNodes Total number of elements to cluster
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param nodeList Vector of shared pointers to the Nodes
+ * @param clusterList Vector of shared pointers to the Clusters
+ * @param totalClusters Total number of clusters
+ * @param kLow Smallest k of the sweep
+ * @param kHigh Largest k of the sweep
+ * @return k Number of medoids of the clustering kept
+ */
+int doKSweep(int totalNodes, const vector< vector<float> > &normScores,
+             vector< shared_ptr<Node> > &nodeList,
+             vector<shared_ptr<Cluster> > &clusterList,
+             int &totalClusters, int kLow, int kHigh);
+
+#endif
@@ -11,26 +11,26 @@
 /**
  * @class Link
  * Represents a link between two Nodes
- * Holds two Nodes and the distance between them
+ * Holds the identifiers of two Nodes and the distance between them
  */
 class Link
 {
     private:
 
         float distance_;       // Distance between the two Nodes
-        shared_ptr<Node> A_;    // Shared pointer to the first Node
-        shared_ptr<Node> B_;    // Shared pointer to the second Node
+        int A_;                // Identifier of the first Node
+        int B_;                // Identifier of the second Node
 
     public:
 
         /**
         * Constructor
         * @param distance Distance between the two Nodes in the link
-        * @param A Shared pointer to the first Node
-        * @param B Shared pointer to the second Node
+        * @param A Identifier of the first Node
+        * @param B Identifier of the second Node
         */
-        Link(shared_ptr<Node> const& A, shared_ptr<Node> const& B,
-             float distance) : distance_(distance), A_(A), B_(B){};
+        Link(int A, int B, float distance) :
+             distance_(distance), A_(A), B_(B){};
 
         /**
         * Return the distance between the link Nodes
@@ -39,16 +39,16 @@ class Link
         float getDistance() { return distance_; };
 
         /**
-        * Return a shared pointer to the first Node
+        * Return the identifier of the first Node
         * @return A
         */
-        shared_ptr<Node> getNodeA() { return A_; }
+        int getNodeA() { return A_; }
 
         /**
-        * Return a shared pointer to the second Node
+        * Return the identifier of the second Node
         * @return B
         */
-        shared_ptr<Node> getNodeB() { return B_; }
+        int getNodeB() { return B_; }
 
 };
 
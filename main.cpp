@@ -25,9 +25,13 @@
  * are implemented in this file.
  */
 
-#include <iostream>
+#include <iostream>
 #include <fstream>
 #include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
 #include <boost/algorithm/string.hpp>
 #include <vector>
 #include <queue>
@@ -35,18 +39,26 @@
 #include <tr1/memory>
 #include "node.h"
 #include "cluster.h"
+#include "kernels.h"
+#include "arena.h"
+#include "cluster_table.h"
 #include "link.h"
 #include "link_comparator.h"
 #include "input.h"
 #include "clustering.h"
+#include "kmedoids.h"
+#include "stats.h"
+#include "benchmark.h"
+#include "output.h"
+#include "sweep.h"
 #include <limits>
-
+
 using namespace std;
-using namespace std::tr1;
+using namespace std::tr1;
+
 
 
-
-int main(int argc, char* argv[])
+int main(int argc, char* argv[])
 {
 
     int totalNodes;             // Number of elements to cluster
@@ -57,6 +69,8 @@ int main(int argc, char* argv[])
     vector< shared_ptr<Node> > nodeList;
     priority_queue<Link,vector<Link>,LinkComparator> linkList;
     vector<shared_ptr<Cluster> > clusterList;
+    Arena arena;            // Memory of the cluster table
+    ClusterTable table;     // State of the hierarchical algorithms
 
     /** User input parameters **/
     bool hMenu=false;   // Show help?
@@ -66,29 +80,71 @@ int main(int argc, char* argv[])
                          // Hierarchical (0) or SPICKER (1)
     int measureType=0;    // Read input as distances (0) or similarities (1)
     float cutoff=0.03;
+    RunOptions options;   // Algorithm-specific parameters
 
     if (readParameters (argc, argv, hMenu, inpFile, clusterAlg,
-                    measureType, cutoff) ) return 1;
+                    measureType, cutoff, options) ) return 1;
+    srand (time(NULL));     // The only seed, for the randomized algorithms
+                            // and the sampled estimates
 
     /** Clustering process **/
+    double inputTime=wallTime();
     readInput (inpFile, totalNodes, rawScores, measureType);
 
-    initNodesAndClusters (totalNodes, nodeList,        // Initialize the lists
-                          clusterList, totalClusters); // of Nodes and Clusters
+    if (options.kLow>0) clusterAlg=-1;  // A k sweep replaces the algorithm
+    int sweepAlg=clusterAlg;            // Engine run at every cutoff of a
+    if (!options.cutoffs.empty())       // cutoff sweep, which replaces the
+    {                                   // algorithm too
+        clusterAlg=-2;
+    }
+    if (options.autoCutoff) clusterAlg=-3;
+    if (options.numClusters>0) clusterAlg=-4;
+
+    /* The hierarchical algorithms work on the cluster table and only build
+       the Nodes and Clusters for the result */
+    bool useTable = (clusterAlg==0 || clusterAlg==3 || clusterAlg==4);
+    if (!useTable)
+    {
+        initNodesAndClusters (totalNodes, nodeList,        // Initialize the lists
+                              clusterList, totalClusters); // of Nodes and Clusters
+    }
     initScores (totalNodes,rawScores,normScores);       // Normalize the Scores
+    inputTime=wallTime()-inputTime;
+
+    double startTime=wallTime();
+    setAllocationCounting(options.benchmark);
+    if (useTable)
+    {
+        arena.reset();
+        table.init(arena,totalNodes);
+        initLinks (totalNodes, normScores, // Initialize the list of Links
+                   linkList);
+    }
 
     switch (clusterAlg)
     {
+        case -4:
+            cutoff=doNumClusters(sweepAlg,normScores,options,nodeList,
+                                 clusterList,totalClusters);
+            break;
+        case -3:
+            cutoff=doAutoCutoff(sweepAlg,normScores,options,nodeList,
+                                clusterList,totalClusters);
+            break;
+        case -2:
+            cutoff=doCutoffSweep(sweepAlg,normScores,options,nodeList,
+                                 clusterList,totalClusters);
+            break;
+        case -1:
+            cutoff=doKSweep(totalNodes,normScores,nodeList, clusterList,
+                            totalClusters,options.kLow,options.kHigh);
+            break;
         case 0:
-            initLinks (totalNodes, normScores, // Initialize the list of Links
-                       linkList, nodeList);
-            doHierarchicalCutoff(linkList, clusterList, // Cluster elements
-                                 totalClusters,cutoff);
+            doHierarchicalCutoff(linkList, table, cutoff); // Cluster elements
             break;
         /*case 1:
-            doHierarchical(linkList,                    // Perform clustering
-                           clusterList, totalClusters); // using all the links
-            break;
+            doHierarchical(linkList, table);            // Perform clustering
+            break;                                      // using all the links
                                                         */
         case 1:
             doSpickerCutoff(totalNodes,normScores,nodeList, clusterList,
@@ -96,19 +152,29 @@ int main(int argc, char* argv[])
             break;
         case 2:
             doKMeans(totalNodes,normScores,nodeList, clusterList,
-                            totalClusters,cutoff);
+                            totalClusters,cutoff,options.approxSamples);
             break;
         case 3:
-            initLinks (totalNodes, normScores, // Initialize the list of Links
-                       linkList, nodeList);
-            doStrictHierarchicalCutoff(linkList, clusterList, // Cluster elements
-                                 totalClusters,cutoff,normScores);
+            doStrictHierarchicalCutoff(linkList, table, // Cluster elements
+                                       cutoff,normScores);
             break;
         case 4:
-            initLinks (totalNodes, normScores, // Initialize the list of Links
-                       linkList, nodeList);
-            doUPGMA(linkList, clusterList, // Cluster elements
-                                 totalClusters,cutoff,normScores);
+            doUPGMA(linkList, table, // Cluster elements
+                    cutoff,normScores);
+            break;
+        case 5:
+            doClara(totalNodes,normScores,nodeList, clusterList,
+                    totalClusters,(int)cutoff,options.samples,
+                    options.sampleSize);
+            break;
+        case 6:
+            doStreamingKMedoids(totalNodes,normScores,nodeList, clusterList,
+                                totalClusters,(int)cutoff,options.stateFile,
+                                options.batchSize,options.reservoirSize);
+            break;
+        case 7:
+            doKCenter(totalNodes,normScores,nodeList, clusterList,
+                      totalClusters,cutoff,options.maxCenters);
             break;
         default:
             printf ("Error: invalid choice of clustering algorithm\n");
@@ -116,179 +182,118 @@ int main(int argc, char* argv[])
 
 
     }
+    if (useTable)
+    {
+        table.exportClusters(nodeList,clusterList,totalClusters);
+    }
+    setAllocationCounting(false);
+    double clusteringTime=wallTime()-startTime;
+    if (options.benchmark)
+    {
+        fprintf(stderr,"Clustering time %f s, allocations %ld (%ld bytes)\n",
+                clusteringTime,getAllocationCount(),getAllocationBytes());
+    }
 
     /** Output generation **/
     int activeClusters=0;
     int orphans=0;
-    float maxIntra=-1;
-    float minInter=std::numeric_limits<float>::max();
-    float DI;
-    float sumAvIntra=0;
+    double statisticsTime=wallTime();
     for (int i=0; i< clusterList.size();i++)
     {
         if (clusterList[i]->getStatus())
         {
             activeClusters++;
-            clusterList[i]->calcCentroid(normScores);
-            clusterList[i]->calcMean(normScores);
-            clusterList[i]->calcMaxDistance(normScores);
-            vector<shared_ptr<Node> > nodes = clusterList[i]->getMembers();
-            maxIntra = (clusterList[i]->getMaxDistance()>maxIntra) ? clusterList[i]->getMaxDistance() : maxIntra;
-            sumAvIntra+=(clusterList[i]->getAvDistance());
-            if (clusterList[i]->getMembers().size() == 1) {orphans++;}
-
-            /* Print out all cluster information */
-
-            printf("Cluster %d : ", clusterList[i]->getID());
-            printf("clustroid %d, ", clusterList[i]->getCentroid()->getID());
-            printf("mean %d, ", clusterList[i]->getMean()->getID());
-            printf("members %d ", nodes.size());
-            if (measureType==1)
-            {
-                printf("radius %f ", (1-clusterList[i]->getRadius()));
-                printf(", minSimilarity %f ",(1-clusterList[i]->
-                                               getMaxDistance()));
-
-                printf(", sumSimilarity %f ",(clusterList[i]->getPairs()
-                                              -clusterList[i]->
-                                              getDistanceSum()));
-
-
-                printf(", avSimilarity %f ",((clusterList[i]->getPairs()
-                                             -clusterList[i]->
-                                             getDistanceSum())
-                                             /clusterList[i]->getPairs()));
-            }
-            else
-            {
-                printf("radius %f ", (clusterList[i]->getRadius()));
-                printf(", maxDistance %f ",(clusterList[i]->
-                                             getMaxDistance()));
-
-                printf(", sumDistance %f ",(clusterList[i]->
-                                            getDistanceSum()));
-
-                printf(", avDistance %f ",((clusterList[i]->
-                                            getDistanceSum())
-                                            /clusterList[i]->getPairs()));
-            }
-            printf(", List of members: ");
-            for (int j = 0 ; j < nodes.size(); j++)
-            {
-                printf ("%d ",nodes[j]->getID());
-            }
-            printf("\n");
+            clusterList[i]->calcStatistics(normScores);
+            if (clusterList[i]->getSize() == 1) {orphans++;}
+        }
+    }
 
+    statisticsTime=wallTime()-statisticsTime;
 
-    /*        printf("Distance matrix: \n");
-            for (int j = 0 ; j < nodes.size(); j++)
-            {
-                for (int k = 0 ; k < nodes.size(); k++)
-                {
-                    printf ("%f ",normScores[nodes[j]->getID()][nodes[k]->getID()]);
-                }
-                printf("\n");
-            }
-            printf("\n");*/
+    /* Print out all cluster information, unless it goes to a binary file.
+       The structured formats replace the whole text report, and go to
+       stdout unless a file is given. */
+    bool structured=(options.outFormat>=2);
+    FILE *reportFile=stdout;
+    if (structured && !options.outFile.empty())
+    {
+        reportFile=fopen(options.outFile.c_str(),"w");
+        if (!reportFile)
+        {
+            printf("Error: could not write %s\n",options.outFile.c_str());
+            return 1;
         }
     }
-    printf("Total number of clusters: %d Orphans: %d ",activeClusters,orphans);
+    OutputBuffer report(reportFile);
+    double outputTime=0;
+    if (options.outFormat!=1)
+    {
+        outputTime=wallTime();
+        writeClusterReports(report,clusterList,measureType,
+                            options.outFormat);
+        report.flush();
+        outputTime=wallTime()-outputTime;
+        if (options.benchmark)
+        {
+            double megabytes=report.getBytesWritten()/1e6;
+            fprintf(stderr,"Output %f MB in %f s (%f MB/s)\n",megabytes,
+                    outputTime,(outputTime>0) ? megabytes/outputTime : 0);
+        }
+    }
+    if (!structured)
+    {
+        printf("Total number of clusters: %d Orphans: %d ",activeClusters,
+               orphans);
+    }
   //  printf("Total number of clusters: %d \nOrphans: %d \n",activeClusters,orphans);
 
-    double minDist;
-  //  printf ("Distance matrix for clusters: \n");
-    int fakei=0;
-    int fakej=0;
-    float silhouetteSum=0;
-    float silhouetteAv;
-    float totalIntraSum=0;
-
-    for (int i=0; i< clusterList.size()-1;i++)
+    float silhouetteAv=0;
+    double totalIntraSum=0;
+
+    /* Label every element with the index of its cluster among the active
+       ones, and compare each element against all the other clusters */
+    vector<int> clusterIndex(totalClusters>clusterList.size() ?
+                             totalClusters : clusterList.size(),-1);
+    vector<int> medoids;    // Mean of every active cluster
+    vector<int> clusterIds; // ID of every active cluster
+    double statsIntraSum=0;   // Sum of a(i) from the cluster statistics
+    int labelCount=0;
+    for (int i=0; i< clusterList.size();i++)
     {
         if (clusterList[i]->getStatus())
         {
-            fakei++;
-            vector<shared_ptr<Node> > nodesi = clusterList[i]->getMembers();
-            fakej=0;
-      /*      for (int j=i+1; j< clusterList.size();j++)
-            {
-                minDist=std::numeric_limits<float>::max();
-                float distSum=0;
-                float avDist=0;*/
-
-            for (int a = 0 ; a < nodesi.size(); a++)
+            clusterIndex[clusterList[i]->getID()]=labelCount++;
+            medoids.push_back(clusterList[i]->getMean()->getID());
+            clusterIds.push_back(clusterList[i]->getID());
+            double m=clusterList[i]->getMembers().size();
+            if (m>1)
             {
-                float minAvInterDist=std::numeric_limits<float>::max();
-                float distInterSum=0;
-                float distIntraSum=0;
-                float avInterDist;
-                float avIntraDist;
-                float maxIntraInter;
-
-
-                if (nodesi.size()<2)
-                {
-                    avIntraDist=0;
-                }
-                else
-                {
-                    for (int c = 0 ; c < nodesi.size(); c++)
-                    {
-                        float d=normScores[nodesi[a]->getID()][nodesi[c]->getID()];
-                        distIntraSum+=d;
-                    }
-                    if ((distIntraSum<=0) || (nodesi.size()==0))
-                    {
-                        avIntraDist=0;
-                    }
-                    else
-                    {
-                        avIntraDist=distIntraSum/(nodesi.size()-1);
-                    }
-                    totalIntraSum+=avIntraDist;
-                }
-
-             //   maxIntraSum=(distIntraSum)
-
-
-                for (int j=i+1; j< clusterList.size();j++)
-                {
-                    if (clusterList[j]->getStatus())
-                    {
-                        fakej++;
-                        vector<shared_ptr<Node> > nodesj = clusterList[j]->getMembers();
-
-                        for (int b = 0 ; b < nodesj.size(); b++)
-                        {
-                            float d=normScores[nodesi[a]->getID()][nodesj[b]->getID()];
-                         //   minDist = (d<minDist) ? d : minDist;
-                            distInterSum+=d;
-                        }
-                        avInterDist=distInterSum/nodesj.size();
-                        minAvInterDist=(avInterDist<minAvInterDist) ? avInterDist : minAvInterDist;
-                    }
-                //    if ( (minDist<0.9) && (minDist>0) )
-                //    {
-                //        printf ("%f ",minDist);
-                //    }
-                  //  minInter = (minDist<minInter) ? minDist : minInter;
-
-                }
-
-
-                maxIntraInter=(avIntraDist>minAvInterDist) ? avIntraDist : minAvInterDist;
-                if (nodesi.size()>1)
-                {
-                    silhouetteSum+=(minAvInterDist-avIntraDist)/maxIntraInter;
-                }
-
-             //                           printf("%f %f %f %f\n",minAvInterDist,avIntraDist,maxIntraInter, silhouetteSum);
+                statsIntraSum+=2*clusterList[i]->getDistanceSum()/(m-1);
             }
-
-          //  printf("\n");
         }
     }
-
+    vector<int> labels(nodeList.size());
+    for (int i=0; i< nodeList.size();i++)
+    {
+        labels[i]=clusterIndex[nodeList[i]->getCluster()];
+    }
+    if (options.outFormat==1)
+    {
+        long bytes;
+        outputTime=wallTime();
+        if (!writeBinaryReport(options.outFile,clusterList,labels,measureType,
+                               cutoff,bytes))
+        {
+            printf("Error: could not write %s\n",options.outFile.c_str());
+            return 1;
+        }
+        outputTime=wallTime()-outputTime;
+        if (options.benchmark)
+        {
+            fprintf(stderr,"Output %f MB in %f s (%f MB/s)\n",bytes/1e6,
+                    outputTime,(outputTime>0) ? bytes/1e6/outputTime : 0);
+        }
+    }
 
     for (int i =0; i< nodeList.size()-1;i++)
     {
@@ -311,9 +316,132 @@ int main(int argc, char* argv[])
     printf("];\n");*/
     //    printf("%f %d\n",silhouetteSum,nodeList.size());
 
-    silhouetteAv=silhouetteSum/nodeList.size();
-    //DI=minInter/maxIntra;
-    printf("Cutoff %f SumAvDist %f AvSil %f\n",cutoff,totalIntraSum,silhouetteAv);
-
-    return 0;
-}
+    /* The exact silhouette is O(n^2), the sampled one stops as soon as it
+       is precise enough and the medoid-based one is O(n*k). In benchmark
+       mode the exact one is also computed to compare them. The pass of the
+       exact one yields the other validity indices as well. */
+    double validityTime=wallTime();
+    bool sampledSilhouette=(options.silhouetteTol>0);
+    bool exactSilhouette=!(options.medoidSilhouette || sampledSilhouette);
+    ValidityIndices indices;
+    double silhouetteTime=wallTime();
+    if (exactSilhouette || options.benchmark)
+    {
+        calcValidityIndices(normScores,labels,medoids,indices);
+        silhouetteAv=indices.silhouette;
+        totalIntraSum=indices.intraSum;
+    }
+    silhouetteTime=wallTime()-silhouetteTime;
+    if (options.benchmark)
+    {
+        fprintf(stderr,"Silhouette exact %f (%f s)\n",silhouetteAv,
+                silhouetteTime);
+    }
+    double halfWidth=0;
+    int sampled=0;
+    if (sampledSilhouette)
+    {
+        double sampleTime=wallTime();
+        float estimate=estimateSilhouette(normScores,labels,labelCount,
+                                          options.silhouetteTol,halfWidth,
+                                          sampled);
+        sampleTime=wallTime()-sampleTime;
+        if (options.benchmark)
+        {
+            fprintf(stderr,"Silhouette sampled %f +/- %f, %d elements "
+                    "(%f s)\n",estimate,halfWidth,sampled,sampleTime);
+        }
+        silhouetteAv=estimate;
+        totalIntraSum=statsIntraSum;
+    }
+    if (options.medoidSilhouette || options.benchmark)
+    {
+        double medoidTime=wallTime();
+        float medoidSilhouette=calcMedoidSilhouette(normScores,labels,
+                                                    medoids);
+        medoidTime=wallTime()-medoidTime;
+        if (options.benchmark)
+        {
+            fprintf(stderr,"Silhouette medoid-based %f (%f s)\n",
+                    medoidSilhouette,medoidTime);
+        }
+        if (options.medoidSilhouette)
+        {
+            silhouetteAv=medoidSilhouette;
+            totalIntraSum=statsIntraSum;
+            sampledSilhouette=false;
+        }
+    }
+    validityTime=wallTime()-validityTime;
+    if (!structured && sampledSilhouette)
+    {
+        printf("Cutoff %f SumAvDist %f AvSil %f +/- %f\n",cutoff,
+               totalIntraSum,silhouetteAv,halfWidth);
+    }
+    else if (!structured)
+    {
+        printf("Cutoff %f SumAvDist %f AvSil %f\n",cutoff,totalIntraSum,silhouetteAv);
+    }
+    if ((exactSilhouette || options.benchmark) && !structured)
+    {
+        printf("Dunn %f DaviesBouldin %f AvIntraDist %f MaxIntraDist %f "
+               "AvInterDist %f MinInterDist %f\n",indices.dunn,
+               indices.daviesBouldin,indices.avIntra,indices.maxIntra,
+               indices.avInter,indices.minInter);
+    }
+
+    /* Single, average and complete linkage between the final clusters */
+    if (!options.distanceFile.empty())
+    {
+        vector<float> minDistance;
+        vector<float> avDistance;
+        vector<float> maxDistance;
+        double distanceTime=wallTime();
+        calcClusterDistances(normScores,labels,labelCount,minDistance,
+                             avDistance,maxDistance);
+        distanceTime=wallTime()-distanceTime;
+        if (options.benchmark)
+        {
+            fprintf(stderr,"Cluster distances %f s\n",distanceTime);
+        }
+        if (!writeClusterDistances(options.distanceFile,clusterIds,
+                                   minDistance,avDistance,maxDistance,
+                                   options.binaryDistances))
+        {
+            printf("Error: could not write %s\n",
+                   options.distanceFile.c_str());
+            return 1;
+        }
+    }
+
+    /* The summary record closes the structured report */
+    if (structured)
+    {
+        ReportSummary summary;
+        summary.totalNodes=nodeList.size();
+        summary.totalClusters=activeClusters;
+        summary.orphans=orphans;
+        summary.measureType=measureType;
+        summary.cutoff=cutoff;
+        summary.silhouette=silhouetteAv;
+        summary.halfWidth=sampledSilhouette ? halfWidth : 0;
+        summary.sumAvDist=totalIntraSum;
+        summary.hasIndices=(exactSilhouette || options.benchmark);
+        summary.dunn=indices.dunn;
+        summary.daviesBouldin=indices.daviesBouldin;
+        summary.inputTime=inputTime;
+        summary.clusteringTime=clusteringTime;
+        summary.statisticsTime=statisticsTime;
+        summary.outputTime=outputTime;
+        summary.validityTime=validityTime;
+        writeReportSummary(report,summary,options.outFormat);
+        report.flush();
+        if (reportFile!=stdout && fclose(reportFile))
+        {
+            printf("Error: could not write %s\n",options.outFile.c_str());
+            return 1;
+        }
+    }
+
+    return 0;
+}
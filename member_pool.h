@@ -0,0 +1,160 @@
+/**
+ * @file member_pool.h
+ * @brief MemberPool and MemberView class definitions
+ *
+ * Defines the pool that stores the members of all the clusters as linked
+ * ranges and the non-owning views used to read them. All methods are inline.
+ */
+
+#ifndef MEMBER_POOL_H
+#define MEMBER_POOL_H
+
+#include "node.h"
+
+/**
+ * @class MemberPool
+ * Holds the members of all the clusters in a single table indexed by
+ * element identifier. The members of a cluster form a chain through the
+ * next-pointers, so no member list is stored per cluster. Each element is in
+ * one chain at a time: building a cluster relinks its members, and the
+ * chains of the clusters they were taken from are no longer valid.
+ */
+class MemberPool
+{
+    private:
+
+        vector<shared_ptr<Node> > nodes_;   // Every element, by identifier
+        vector<int> next_;                  // Next member in the same
+                                            // cluster, -1 at the end
+
+    public:
+
+        /**
+        * Links the elements of a list into a chain, in list order, and
+        * registers their Nodes
+        * @param members Vector with the elements to link
+        * @param head Identifier of the first element of the chain, -1 if
+        *            there are no elements
+        * @param tail Identifier of the last element of the chain
+        */
+        void link(vector<shared_ptr<Node> > &members, int &head, int &tail)
+        {
+            head=-1;
+            tail=-1;
+            if (members.empty()) return;
+            for (int i=0; i<members.size(); i++)
+            {
+                int id=members[i]->getID();
+                if (id>=next_.size())
+                {
+                    next_.resize(id+1,-1);
+                    nodes_.resize(id+1);
+                }
+                nodes_[id]=members[i];
+                next_[id]=-1;
+                if (i>0) next_[members[i-1]->getID()]=id;
+            }
+            head=members[0]->getID();
+            tail=members[members.size()-1]->getID();
+        };
+
+        /**
+        * Returns the element that follows another one in its chain
+        * @param id Element identifier
+        * @return next Identifier of the next element, -1 at the end
+        */
+        int next(int id) const {return next_[id];};
+
+        /**
+        * Returns the Node of an element
+        * @param id Element identifier
+        * @return node Shared pointer to the Node
+        */
+        shared_ptr<Node> node(int id) const {return nodes_[id];};
+};
+
+/**
+ * @class MemberView
+ * Non-owning view of the members of a cluster in a MemberPool. It walks a
+ * fixed number of elements from the head of the chain and yields their
+ * identifiers. Copying a view copies neither the members nor any Node.
+ */
+class MemberView
+{
+    private:
+
+        const MemberPool *pool_;    // Pool holding the chain
+        int head_;                  // First member
+        int size_;                  // Number of members
+
+    public:
+
+        /**
+        * @class iterator
+        * Forward iterator over the member identifiers
+        */
+        class iterator
+        {
+            private:
+
+                const MemberPool *pool_;
+                int id_;            // Current member
+                int remaining_;     // Members left, including the current
+
+            public:
+
+                iterator(const MemberPool *pool, int id, int remaining) :
+                         pool_(pool), id_(id), remaining_(remaining){};
+                int operator*() const {return id_;};
+                iterator &operator++()
+                {
+                    remaining_--;
+                    id_= (remaining_>0) ? pool_->next(id_) : -1;
+                    return *this;
+                };
+                bool operator==(const iterator &other) const
+                {
+                    return remaining_==other.remaining_;
+                };
+                bool operator!=(const iterator &other) const
+                {
+                    return remaining_!=other.remaining_;
+                };
+        };
+
+        /**
+        * Constructor
+        * @param pool Pool holding the chain
+        * @param head Identifier of the first member
+        * @param size Number of members
+        */
+        MemberView(const MemberPool *pool, int head, int size) :
+                   pool_(pool), head_(head), size_(size){};
+
+        iterator begin() const {return iterator(pool_,head_,size_);};
+        iterator end() const {return iterator(pool_,-1,0);};
+
+        /**
+        * Returns the number of members
+        * @return size
+        */
+        int size() const {return size_;};
+
+        /**
+        * Copies the member identifiers into a contiguous array, for the
+        * scans that need locality
+        * @param ids Vector that receives the identifiers
+        */
+        void copyIds(vector<int> &ids) const
+        {
+            ids.resize(size_);
+            int id=head_;
+            for (int i=0; i<size_; i++)
+            {
+                ids[i]=id;
+                id=pool_->next(id);
+            }
+        };
+};
+
+#endif
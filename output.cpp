@@ -0,0 +1,387 @@
+/**
+ * @file output.cpp
+ * @brief Implementation of output-related functions
+ *
+ * Implements the functions that write results to files
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <tr1/memory>
+#include "node.h"
+#include "cluster.h"
+
+using namespace std;
+using namespace std::tr1;
+
+#include "output.h"
+
+
+OutputBuffer::OutputBuffer(FILE *file, size_t chunkSize) : used_(0),
+                           file_(file), chunkSize_(chunkSize),
+                           bytesWritten_(0)
+{
+    if (file_) data_.resize(chunkSize_);
+}
+
+void OutputBuffer::appendSlow(const char *text, size_t length)
+{
+    if (file_)
+    {
+        flush();
+        if (length>=chunkSize_)     // Too large to be worth copying
+        {
+            bytesWritten_+=fwrite(text,1,length,file_);
+            return;
+        }
+    }
+    else
+    {
+        size_t grown=2*data_.size();
+        data_.resize((grown>used_+length) ? grown : used_+length+256);
+    }
+    memcpy(&data_[used_],text,length);
+    used_+=length;
+}
+
+void OutputBuffer::appendInt(long value)
+{
+    char digits[24];
+    char *end=digits+sizeof(digits);
+    char *p=end;
+    unsigned long magnitude = (value<0) ? -(unsigned long)value : value;
+    do
+    {
+        *--p=(char)('0'+magnitude%10);
+        magnitude/=10;
+    } while (magnitude);
+    if (value<0) *--p='-';
+    append(p,end-p);
+}
+
+void OutputBuffer::appendFloat(double value)
+{
+    char text[64];
+    int length=snprintf(text,sizeof(text),"%f",value);
+    if (length>=(int)sizeof(text))  // Huge values, rare enough for printf
+    {
+        vector<char> large(length+1);
+        snprintf(&large[0],large.size(),"%f",value);
+        append(&large[0],length);
+        return;
+    }
+    append(text,length);
+}
+
+void OutputBuffer::flush()
+{
+    if (file_ && used_)
+    {
+        bytesWritten_+=fwrite(&data_[0],1,used_,file_);
+        used_=0;
+    }
+}
+
+/**
+ * Formats the report line of one cluster, field by field as the former
+ * printf calls did
+ * @param out OutputBuffer that receives the line
+ * @param cluster Active cluster with up to date statistics
+ * @param measureType Report similarities (1) or distances (0)
+ */
+static void formatClusterReport(OutputBuffer &out, Cluster &cluster,
+                                int measureType)
+{
+    MemberView nodes=cluster.getMembers();
+    out.append("Cluster ");
+    out.appendInt(cluster.getID());
+    out.append(" : clustroid ");
+    out.appendInt(cluster.getCentroid()->getID());
+    out.append(", mean ");
+    out.appendInt(cluster.getMean()->getID());
+    out.append(", members ");
+    out.appendInt(nodes.size());
+    if (measureType==1)
+    {
+        out.append(" radius ");
+        out.appendFloat(1-cluster.getRadius());
+        out.append(" , minSimilarity ");
+        out.appendFloat(1-cluster.getMaxDistance());
+        out.append(" , sumSimilarity ");
+        out.appendFloat(cluster.getPairs()-cluster.getDistanceSum());
+        out.append(" , avSimilarity ");
+        out.appendFloat((cluster.getPairs()-cluster.getDistanceSum())
+                        /cluster.getPairs());
+    }
+    else
+    {
+        out.append(" radius ");
+        out.appendFloat(cluster.getRadius());
+        out.append(" , maxDistance ");
+        out.appendFloat(cluster.getMaxDistance());
+        out.append(" , sumDistance ");
+        out.appendFloat(cluster.getDistanceSum());
+        out.append(" , avDistance ");
+        out.appendFloat(cluster.getDistanceSum()/cluster.getPairs());
+    }
+    out.append(" , List of members: ");
+    for (MemberView::iterator it=nodes.begin(); it!=nodes.end(); ++it)
+    {
+        out.appendInt(*it);
+        out.append(" ",1);
+    }
+    out.append("\n",1);
+}
+
+/**
+ * Appends a number of a structured record; JSON has no NaN or infinity,
+ * so they are written as null, and as empty fields in TSV
+ */
+static void appendField(OutputBuffer &out, double value, bool json)
+{
+    if (value!=value || value-value!=0)
+    {
+        if (json) out.append("null");
+        return;
+    }
+    out.appendFloat(value);
+}
+
+/**
+ * Formats the record of one cluster in JSON-lines or TSV format, with the
+ * same statistics as the report line
+ * @param out OutputBuffer that receives the record
+ * @param cluster Active cluster with up to date statistics
+ * @param measureType Report similarities (1) or distances (0)
+ * @param json TRUE for JSON lines, FALSE for TSV
+ */
+static void formatClusterRecord(OutputBuffer &out, Cluster &cluster,
+                                int measureType, bool json)
+{
+    MemberView nodes=cluster.getMembers();
+    double values[4];
+    if (measureType==1)
+    {
+        values[0]=1-cluster.getRadius();
+        values[1]=1-cluster.getMaxDistance();
+        values[2]=cluster.getPairs()-cluster.getDistanceSum();
+        values[3]=(cluster.getPairs()-cluster.getDistanceSum())
+                  /cluster.getPairs();
+    }
+    else
+    {
+        values[0]=cluster.getRadius();
+        values[1]=cluster.getMaxDistance();
+        values[2]=cluster.getDistanceSum();
+        values[3]=cluster.getDistanceSum()/cluster.getPairs();
+    }
+    const char *names[2][4]={{"\"radius\":","\"maxDistance\":",
+                              "\"sumDistance\":","\"avDistance\":"},
+                             {"\"radius\":","\"minSimilarity\":",
+                              "\"sumSimilarity\":","\"avSimilarity\":"}};
+    const char *separator = json ? "," : "\t";
+    if (json) out.append("{\"type\":\"cluster\",\"id\":");
+    out.appendInt(cluster.getID());
+    out.append(json ? ",\"clustroid\":" : "\t");
+    out.appendInt(cluster.getCentroid()->getID());
+    out.append(json ? ",\"mean\":" : "\t");
+    out.appendInt(cluster.getMean()->getID());
+    out.append(json ? ",\"members\":" : "\t");
+    out.appendInt(nodes.size());
+    for (int v=0; v<4; v++)
+    {
+        out.append(separator);
+        if (json) out.append(names[measureType==1][v]);
+        appendField(out,values[v],json);
+    }
+    out.append(json ? ",\"memberList\":[" : "\t");
+    bool first=true;
+    for (MemberView::iterator it=nodes.begin(); it!=nodes.end(); ++it)
+    {
+        if (!first) out.append(",",1);
+        out.appendInt(*it);
+        first=false;
+    }
+    out.append(json ? "]}\n" : "\n");
+}
+
+void writeClusterReports(OutputBuffer &out,
+                         const vector<shared_ptr<Cluster> > &clusterList,
+                         int measureType, int format)
+{
+    const int batchSize=256;    // Clusters formatted per parallel round
+    if (format==3)
+    {
+        out.append(measureType==1 ?
+                   "id\tclustroid\tmean\tmembers\tradius\tminSimilarity\t"
+                   "sumSimilarity\tavSimilarity\tmemberList\n" :
+                   "id\tclustroid\tmean\tmembers\tradius\tmaxDistance\t"
+                   "sumDistance\tavDistance\tmemberList\n");
+    }
+    vector<Cluster*> active;
+    for (int i=0; i<clusterList.size(); i++)
+    {
+        if (clusterList[i]->getStatus()) active.push_back(clusterList[i].get());
+    }
+    vector<OutputBuffer> records(batchSize);
+    for (int first=0; first<(int)active.size(); first+=batchSize)
+    {
+        int count=(first+batchSize<(int)active.size()) ? batchSize :
+                  (int)active.size()-first;
+        #pragma omp parallel for schedule(dynamic)
+        for (int r=0; r<count; r++)
+        {
+            records[r].clear();
+            if (format==0)
+            {
+                formatClusterReport(records[r],*active[first+r],measureType);
+            }
+            else
+            {
+                formatClusterRecord(records[r],*active[first+r],measureType,
+                                    format==2);
+            }
+        }
+        for (int r=0; r<count; r++)
+        {
+            out.append(records[r]);
+        }
+    }
+}
+
+void writeReportSummary(OutputBuffer &out, const ReportSummary &summary,
+                        int format)
+{
+    bool json=(format==2);
+    const char *separator = json ? ",\"" : "\t";
+    const char *assign = json ? "\":" : "=";
+    const int totalCounts=4;
+    const char *countNames[totalCounts]={"elements","clusters","orphans",
+                                         "measureType"};
+    int counts[totalCounts]={summary.totalNodes,summary.totalClusters,
+                             summary.orphans,summary.measureType};
+    const int totalValues=11;
+    const char *valueNames[totalValues]={"cutoff","silhouette",
+                                         "silhouetteHalfWidth","sumAvDist",
+                                         "dunn","daviesBouldin","inputTime",
+                                         "clusteringTime","statisticsTime",
+                                         "outputTime","validityTime"};
+    double values[totalValues]={summary.cutoff,summary.silhouette,
+                                summary.halfWidth,summary.sumAvDist,
+                                summary.dunn,summary.daviesBouldin,
+                                summary.inputTime,summary.clusteringTime,
+                                summary.statisticsTime,summary.outputTime,
+                                summary.validityTime};
+    out.append(json ? "{\"type\":\"summary\"" : "#summary");
+    for (int c=0; c<totalCounts; c++)
+    {
+        out.append(separator);
+        out.append(countNames[c]);
+        out.append(assign);
+        out.appendInt(counts[c]);
+    }
+    for (int v=0; v<totalValues; v++)
+    {
+        bool isIndex=(v==4 || v==5);
+        if (isIndex && !summary.hasIndices) continue;
+        out.append(separator);
+        out.append(valueNames[v]);
+        out.append(assign);
+        appendField(out,values[v],json);
+    }
+    out.append(json ? "}\n" : "\n");
+}
+
+bool writeBinaryReport(const string &outFile,
+                       const vector<shared_ptr<Cluster> > &clusterList,
+                       const vector<int> &labels, int measureType,
+                       float cutoff, long &bytes)
+{
+    bytes=0;
+    FILE *file=fopen(outFile.c_str(),"wb");
+    if (!file) return false;
+    vector<ClusterRecord> records;
+    for (int i=0; i<clusterList.size(); i++)
+    {
+        Cluster &cluster=*clusterList[i];
+        if (!cluster.getStatus()) continue;
+        ClusterRecord record;
+        record.id=cluster.getID();
+        record.centroid=cluster.getCentroid()->getID();
+        record.mean=cluster.getMean()->getID();
+        record.size=cluster.getSize();
+        record.radius=cluster.getRadius();
+        record.maxDistance=cluster.getMaxDistance();
+        record.distanceSum=cluster.getDistanceSum();
+        records.push_back(record);
+    }
+
+    ReportHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,"CLUSTBIN",8);
+    header.version=1;
+    header.totalNodes=labels.size();
+    header.totalClusters=records.size();
+    header.measureType=measureType;
+    header.cutoff=cutoff;
+    header.recordSize=sizeof(ClusterRecord);
+
+    {
+        OutputBuffer out(file);
+        const int padding=0;
+        out.append((const char*)&header,sizeof(header));
+        if (!labels.empty())
+        {
+            out.append((const char*)&labels[0],labels.size()*sizeof(int));
+        }
+        if (labels.size()%2) out.append((const char*)&padding,sizeof(int));
+        if (!records.empty())
+        {
+            out.append((const char*)&records[0],
+                       records.size()*sizeof(ClusterRecord));
+        }
+        out.flush();
+        bytes=out.getBytesWritten();
+    }
+    bool written=!ferror(file);
+    return (fclose(file)==0) && written;
+}
+
+bool writeClusterDistances(const string &outFile, const vector<int> &clusterIds,
+                           const vector<float> &minDistance,
+                           const vector<float> &avDistance,
+                           const vector<float> &maxDistance, bool binary)
+{
+    int k=clusterIds.size();
+    if (binary)
+    {
+        ofstream outfile(outFile.c_str(),ios::out | ios::binary);
+        outfile.write((const char*)&k,sizeof(int));
+        if (k>0)
+        {
+            streamsize bytes=(streamsize)k*k*sizeof(float);
+            outfile.write((const char*)&clusterIds[0],k*sizeof(int));
+            outfile.write((const char*)&minDistance[0],bytes);
+            outfile.write((const char*)&avDistance[0],bytes);
+            outfile.write((const char*)&maxDistance[0],bytes);
+        }
+        return outfile.good();
+    }
+
+    ofstream outfile(outFile.c_str());
+    outfile << "clusterA\tclusterB\tminDistance\tavDistance\tmaxDistance\n";
+    for (int a=0; a<k; a++)
+    {
+        for (int b=a; b<k; b++)
+        {
+            size_t e=(size_t)a*k+b;
+            outfile << clusterIds[a] << "\t" << clusterIds[b] << "\t"
+                    << minDistance[e] << "\t" << avDistance[e] << "\t"
+                    << maxDistance[e] << "\n";
+        }
+    }
+    return outfile.good();
+}
@@ -0,0 +1,236 @@
+/**
+ * @file output.h
+ * @brief Definition of output-related functions
+ *
+ * Defines the buffered writer used for the cluster report and the functions
+ * that write results to files, besides the report printed on stdout
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+/**
+ * @class OutputBuffer
+ * Text buffer that formats numbers without going through printf for every
+ * field. A buffer attached to a file writes its contents in large chunks;
+ * a buffer without a file only grows, and is used to format records that
+ * are later appended to another buffer.
+ */
+class OutputBuffer
+{
+    private:
+
+        vector<char> data_;     // Storage of the text not written yet
+        size_t used_;           // Characters of data_ in use
+        FILE *file_;            // Destination, NULL to keep the text
+        size_t chunkSize_;      // Size of the writes to file_
+        long bytesWritten_;     // Bytes written to file_ so far
+
+        /**
+        * Appends text that does not fit in the storage: writes the storage
+        * to the file, or grows it
+        */
+        void appendSlow(const char *text, size_t length);
+
+    public:
+
+        /**
+        * Constructor
+        * @param file Destination of the text, NULL to keep it in memory
+        * @param chunkSize Amount of text gathered before writing it
+        */
+        OutputBuffer(FILE *file=0, size_t chunkSize=1<<20);
+
+        /**
+        * Destructor, writes the remaining text
+        */
+        ~OutputBuffer(){flush();};
+
+        /**
+        * Appends a string of characters
+        * @param text Characters to append
+        * @param length Number of characters
+        */
+        void append(const char *text, size_t length)
+        {
+            if (used_+length>data_.size())
+            {
+                appendSlow(text,length);
+                return;
+            }
+            memcpy(&data_[used_],text,length);
+            used_+=length;
+        };
+
+        /**
+        * Appends a null-terminated string
+        * @param text String to append
+        */
+        void append(const char *text){append(text,strlen(text));};
+
+        /**
+        * Appends the text held by another buffer
+        * @param other OutputBuffer without a file
+        */
+        void append(const OutputBuffer &other)
+        {
+            if (other.used_) append(&other.data_[0],other.used_);
+        };
+
+        /**
+        * Appends an integer in decimal, as printf's %d
+        * @param value Integer to append
+        */
+        void appendInt(long value);
+
+        /**
+        * Appends a real number with six decimals, as printf's %f
+        * @param value Number to append
+        */
+        void appendFloat(double value);
+
+        /**
+        * Discards the text not written yet
+        */
+        void clear(){used_=0;};
+
+        /**
+        * Writes the text gathered so far to the file, if there is one
+        */
+        void flush();
+
+        /**
+        * Returns the number of bytes written to the file so far
+        * @return bytes
+        */
+        long getBytesWritten(){return bytesWritten_;};
+};
+
+/**
+ * @struct ReportHeader
+ * Header of the binary report. The file holds the header, the label of
+ * every element in identifier order as 32-bit integers, 4 bytes of padding
+ * if the number of elements is odd, and one ClusterRecord per active
+ * cluster; a label is the index of the record of the cluster of the
+ * element. All the fields are in the byte order of the machine, aligned so
+ * that the file can be mapped and used in place.
+ */
+struct ReportHeader
+{
+    char magic[8];          // "CLUSTBIN"
+    int version;            // Format version, 1
+    int totalNodes;         // Number of elements
+    int totalClusters;      // Number of records
+    int measureType;        // Input read as distances (0) or similarities (1)
+    float cutoff;           // Cutoff given to the clustering
+    int recordSize;         // sizeof(ClusterRecord), 32
+};
+
+/**
+ * @struct ClusterRecord
+ * Summary of one cluster in the binary report. The distances are the ones
+ * used by the clustering, 1-similarity for similarity input.
+ */
+struct ClusterRecord
+{
+    int id;                 // Cluster identifier
+    int centroid;           // Clustroid element
+    int mean;               // Mean (medoid) element
+    int size;               // Number of members
+    float radius;           // Largest distance from the clustroid
+    float maxDistance;      // Largest distance between two members
+    double distanceSum;     // Sum of the distances between the members
+};
+
+/**
+ * @struct ReportSummary
+ * Totals, quality statistics and timings of a run, written as the last
+ * record of the structured reports
+ */
+struct ReportSummary
+{
+    int totalNodes;         // Number of elements
+    int totalClusters;      // Number of active clusters
+    int orphans;            // Clusters with a single member
+    int measureType;        // Input read as distances (0) or similarities (1)
+    float cutoff;           // Cutoff given to the clustering
+    double silhouette;      // Average silhouette
+    double halfWidth;       // Half width of its 95% interval, 0 if exact
+    double sumAvDist;       // Sum of the average intra-cluster distances
+    bool hasIndices;        // The indices below were computed
+    double dunn;            // Dunn index
+    double daviesBouldin;   // Davies-Bouldin index
+    double inputTime;       // Seconds spent reading the input
+    double clusteringTime;  // Seconds spent clustering
+    double statisticsTime;  // Seconds spent in the cluster statistics
+    double outputTime;      // Seconds spent writing the cluster records
+    double validityTime;    // Seconds spent in the silhouette and indices
+};
+
+/**
+ * Writes the report of every active cluster: identifier, clustroid, mean,
+ * size, radius, distance statistics and list of members. In text format
+ * every cluster is one line of the original report; in JSON-lines format
+ * one object with "type":"cluster"; in TSV format one row, after a header
+ * row, with the members separated by commas. Batches of clusters are
+ * formatted in parallel into separate buffers, which are then appended in
+ * the order of the list, so the memory used does not grow with the size
+ * of the report. The statistics of the clusters must be up to date.
+ * @param out OutputBuffer that receives the records
+ * @param clusterList Vector of shared pointers containing all the Clusters
+ * @param measureType Report similarities (1) or distances (0)
+ * @param format Text (0), JSON lines (2) or TSV (3)
+ */
+void writeClusterReports(OutputBuffer &out,
+                         const vector<shared_ptr<Cluster> > &clusterList,
+                         int measureType, int format=0);
+
+/**
+ * Writes the summary record that ends a structured report: a JSON object
+ * with "type":"summary", or a TSV line starting with "#summary" followed by
+ * name=value fields
+ * @param out OutputBuffer that receives the record
+ * @param summary ReportSummary to write
+ * @param format JSON lines (2) or TSV (3)
+ */
+void writeReportSummary(OutputBuffer &out, const ReportSummary &summary,
+                        int format);
+
+/**
+ * Writes the binary report of the active clusters, laid out as described
+ * in ReportHeader. The statistics of the clusters must be up to date.
+ * @param outFile Name of the file to write
+ * @param clusterList Vector of shared pointers containing all the Clusters
+ * @param labels Index of the cluster of every element among the active ones
+ * @param measureType Input read as distances (0) or similarities (1)
+ * @param cutoff Cutoff given to the clustering
+ * @param bytes Receives the size of the file
+ * @return true if the file was written
+ */
+bool writeBinaryReport(const string &outFile,
+                       const vector<shared_ptr<Cluster> > &clusterList,
+                       const vector<int> &labels, int measureType,
+                       float cutoff, long &bytes);
+
+/**
+ * Writes the single, average and complete linkage distances between every
+ * pair of clusters, as computed by calcClusterDistances. The TSV format has
+ * a header line and one line per pair of clusters A<=B: A, B, minimum,
+ * average and maximum distance. The binary format holds the number of
+ * clusters k and the k cluster identifiers as 32-bit integers, followed by
+ * the k x k minimum, average and maximum matrices by rows as 32-bit floats,
+ * all in the byte order of the machine.
+ * @param outFile Name of the file to write
+ * @param clusterIds Identifier of the cluster of every label
+ * @param minDistance k x k smallest distances
+ * @param avDistance k x k average distances
+ * @param maxDistance k x k largest distances
+ * @param binary TRUE for the binary format, FALSE for TSV
+ * @return true if the file was written
+ */
+bool writeClusterDistances(const string &outFile, const vector<int> &clusterIds,
+                           const vector<float> &minDistance,
+                           const vector<float> &avDistance,
+                           const vector<float> &maxDistance, bool binary);
+
+#endif
@@ -0,0 +1,498 @@
+/**
+ * @file stats.cpp
+ * @brief Implementation of functions for clustering quality statistics
+ *
+ * Implements the functions that evaluate a clustering given as a label array
+ */
+
+#include <tr1/memory>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+using namespace std::tr1;
+
+#include "stats.h"
+
+
+void groupByLabel(const vector<int> &labels, int k,
+                  vector<int> &offsets, vector<int> &members)
+{
+    offsets.assign(k+1,0);
+    for (int i=0; i<labels.size(); i++) offsets[labels[i]+1]++;
+    for (int c=0; c<k; c++) offsets[c+1]+=offsets[c];
+    members.resize(labels.size());
+    vector<int> next(offsets.begin(),offsets.end()-1);
+    for (int i=0; i<labels.size(); i++) members[next[labels[i]]++]=i;
+}
+
+/**
+ * Sums one row of the distance matrix over the members of every cluster,
+ * filling one row of the element by cluster table of distance sums, and
+ * optionally the smallest and largest distance to every cluster
+ * @param minToCluster Receives the smallest distances, or NULL
+ * @param maxToCluster Receives the largest distances, or NULL
+ */
+static void reduceRowByCluster(const float *row, int k,
+                               const vector<int> &offsets,
+                               const vector<int> &members,
+                               double *distToCluster, float *minToCluster,
+                               float *maxToCluster)
+{
+    /* One pass over the row, cluster by cluster, so that every reduction
+       is a vectorized gather over sorted columns */
+    for (int c=0; c<k; c++)
+    {
+        const int *cols=&members[0]+offsets[c];
+        int size=offsets[c+1]-offsets[c];
+        double sum=0;
+        if (minToCluster)
+        {
+            float minimum=std::numeric_limits<float>::max();
+            float maximum=-std::numeric_limits<float>::max();
+            #pragma omp simd reduction(+:sum) reduction(min:minimum) \
+                             reduction(max:maximum)
+            for (int j=0; j<size; j++)
+            {
+                float d=row[cols[j]];
+                sum+=d;
+                minimum = (d<minimum) ? d : minimum;
+                maximum = (d>maximum) ? d : maximum;
+            }
+            minToCluster[c]=minimum;
+            maxToCluster[c]=maximum;
+        }
+        else
+        {
+            #pragma omp simd reduction(+:sum)
+            for (int j=0; j<size; j++) sum+=row[cols[j]];
+        }
+        distToCluster[c]=sum;
+    }
+}
+
+/**
+ * Computes s(i) and a(i) of one element from its row of the element by
+ * cluster table of distance sums
+ * @return FALSE if the element is in a singleton, which has s(i)=0 and no
+ *        a(i)
+ */
+static bool silhouetteFromSums(const double *distToCluster, int own, int k,
+                               const vector<int> &offsets,
+                               double &s, double &a)
+{
+    s=0;
+    int ownSize=offsets[own+1]-offsets[own];
+    if (ownSize<2) return false;
+
+    a=distToCluster[own]/(ownSize-1);
+    double b=std::numeric_limits<double>::max();
+    for (int c=0; c<k; c++)
+    {
+        int size=offsets[c+1]-offsets[c];
+        if (c==own || size==0) continue;
+        double avInter=distToCluster[c]/size;
+        b = (avInter<b) ? avInter : b;
+    }
+    if (b==std::numeric_limits<double>::max()) return true; // One cluster
+    double maxAB = (a>b) ? a : b;
+    if (maxAB>0)
+    {
+        s=(b-a)/maxAB;
+    }
+    return true;
+}
+
+/**
+ * Computes s(i) and a(i) of one element from its row of the distance matrix,
+ * filling its row of the element by cluster table of distance sums
+ * @return FALSE if the element is in a singleton, which has s(i)=0 and no
+ *        a(i)
+ */
+static bool elementSilhouette(const float *row, int own, int k,
+                              const vector<int> &offsets,
+                              const vector<int> &members,
+                              vector<double> &distToCluster,
+                              double &s, double &a)
+{
+    s=0;
+    if (offsets[own+1]-offsets[own]<2) return false;
+    reduceRowByCluster(row,k,offsets,members,&distToCluster[0],0,0);
+    return silhouetteFromSums(&distToCluster[0],own,k,offsets,s,a);
+}
+
+double calcSilhouette(const vector< vector<float> > &normScores,
+                      const vector<int> &labels, int k, double &intraSum)
+{
+    int totalNodes=labels.size();
+    vector<int> offsets;    // Members of cluster c are members[offsets[c]]
+    vector<int> members;    // to members[offsets[c+1]-1], in increasing order
+    groupByLabel(labels,k,offsets,members);
+
+    double silhouetteSum=0;
+    double intra=0;
+    #pragma omp parallel reduction(+:silhouetteSum,intra)
+    {
+        vector<double> distToCluster(k);  // Distance sum from i to each
+                                          // cluster, one row of the n x C
+                                          // table at a time
+        #pragma omp for schedule(dynamic,16)
+        for (int i=0; i<totalNodes; i++)
+        {
+            double s;
+            double a;
+            if (elementSilhouette(&normScores[i][0],labels[i],k,offsets,
+                                  members,distToCluster,s,a))
+            {
+                silhouetteSum+=s;
+                intra+=a;
+            }
+        }
+    }
+    intraSum=intra;
+    return (totalNodes>0) ? silhouetteSum/totalNodes : 0;
+}
+
+double calcSilhouette(const vector< vector<float> > &normScores,
+                      const vector<int> &labels, int k)
+{
+    double intraSum;
+    return calcSilhouette(normScores,labels,k,intraSum);
+}
+
+void calcValidityIndices(const vector< vector<float> > &normScores,
+                         const vector<int> &labels,
+                         const vector<int> &medoids,
+                         ValidityIndices &indices)
+{
+    int totalNodes=labels.size();
+    int k=medoids.size();
+    vector<int> offsets;
+    vector<int> members;
+    groupByLabel(labels,k,offsets,members);
+
+    double silhouetteSum=0;
+    double intra=0;
+    double intraPairSum=0;      // Sum of the distances within clusters
+    double interPairSum=0;      // Sum of the distances between clusters
+    float maxIntra=0;
+    float minInter=std::numeric_limits<float>::max();
+    vector<double> scatter(k,0);    // Sum of the distances to the medoid
+    #pragma omp parallel reduction(+:silhouetteSum,intra,intraPairSum, \
+                                   interPairSum)
+    {
+        vector<double> distToCluster(k);
+        vector<float> minToCluster(k);
+        vector<float> maxToCluster(k);
+        vector<double> threadScatter(k,0);
+        float threadMaxIntra=0;
+        float threadMinInter=std::numeric_limits<float>::max();
+        #pragma omp for schedule(dynamic,16)
+        for (int i=0; i<totalNodes; i++)
+        {
+            const float *row=&normScores[i][0];
+            int own=labels[i];
+            reduceRowByCluster(row,k,offsets,members,&distToCluster[0],
+                               &minToCluster[0],&maxToCluster[0]);
+            double s;
+            double a;
+            if (silhouetteFromSums(&distToCluster[0],own,k,offsets,s,a))
+            {
+                silhouetteSum+=s;
+                intra+=a;
+            }
+            threadScatter[own]+=row[medoids[own]];
+            threadMaxIntra = (maxToCluster[own]>threadMaxIntra) ?
+                             maxToCluster[own] : threadMaxIntra;
+            for (int c=0; c<k; c++)
+            {
+                if (c==own)
+                {
+                    intraPairSum+=distToCluster[c];
+                    continue;
+                }
+                interPairSum+=distToCluster[c];
+                threadMinInter = (minToCluster[c]<threadMinInter) ?
+                                 minToCluster[c] : threadMinInter;
+            }
+        }
+        #pragma omp critical
+        {
+            for (int c=0; c<k; c++) scatter[c]+=threadScatter[c];
+            maxIntra = (threadMaxIntra>maxIntra) ? threadMaxIntra : maxIntra;
+            minInter = (threadMinInter<minInter) ? threadMinInter : minInter;
+        }
+    }
+
+    /* Davies-Bouldin: average over the clusters of the worst ratio between
+       the scatters of two clusters and the distance between their medoids.
+       Pairs of coincident medoids are skipped. */
+    double dbSum=0;
+    for (int c=0; c<k; c++)
+    {
+        scatter[c]/=(offsets[c+1]-offsets[c]);
+    }
+    for (int c=0; c<k; c++)
+    {
+        double worst=0;
+        for (int d=0; d<k; d++)
+        {
+            float separation=normScores[medoids[c]][medoids[d]];
+            if (d==c || separation<=0) continue;
+            double ratio=(scatter[c]+scatter[d])/separation;
+            worst = (ratio>worst) ? ratio : worst;
+        }
+        dbSum+=worst;
+    }
+
+    double intraPairs=0;        // Ordered pairs of different members
+    for (int c=0; c<k; c++)
+    {
+        double size=offsets[c+1]-offsets[c];
+        intraPairs+=size*(size-1);
+    }
+    double interPairs=(double)totalNodes*totalNodes-totalNodes-intraPairs;
+
+    indices.silhouette=(totalNodes>0) ? silhouetteSum/totalNodes : 0;
+    indices.intraSum=intra;
+    indices.maxIntra=maxIntra;
+    indices.minInter=(interPairs>0) ? minInter : 0;
+    indices.avIntra=(intraPairs>0) ? intraPairSum/intraPairs : 0;
+    indices.avInter=(interPairs>0) ? interPairSum/interPairs : 0;
+    indices.dunn=(maxIntra>0) ? indices.minInter/maxIntra : 0;
+    indices.daviesBouldin=(k>0) ? dbSum/k : 0;
+}
+
+void calcClusterDistances(const vector< vector<float> > &normScores,
+                          const vector<int> &labels, int k,
+                          vector<float> &minDistance,
+                          vector<float> &avDistance,
+                          vector<float> &maxDistance)
+{
+    const int blockEntries=1<<18;   // Entries of the per-thread buffers
+    vector<int> offsets;
+    vector<int> members;
+    groupByLabel(labels,k,offsets,members);
+    minDistance.assign((size_t)k*k,std::numeric_limits<float>::max());
+    avDistance.assign((size_t)k*k,0);
+    maxDistance.assign((size_t)k*k,0);
+    vector<double> sums((size_t)k*k,0);
+    if (k==0) return;
+
+    /* The members are sorted by label, so a block of rows of the cluster
+       matrix is filled by a contiguous range of elements. Every thread
+       accumulates its elements into its own buffers for the block, which
+       are merged once the range is done. */
+    int blockRows=(blockEntries/k>0) ? blockEntries/k : 1;
+    for (int first=0; first<k; first+=blockRows)
+    {
+        int last=(first+blockRows<k) ? first+blockRows : k;
+        int rows=last-first;
+        int start=offsets[first];
+        int end=offsets[last];
+        #pragma omp parallel
+        {
+            vector<double> distToCluster(k);
+            vector<float> minToCluster(k);
+            vector<float> maxToCluster(k);
+            vector<double> threadSums((size_t)rows*k,0);
+            vector<float> threadMin((size_t)rows*k,
+                                    std::numeric_limits<float>::max());
+            vector<float> threadMax((size_t)rows*k,0);
+            #pragma omp for schedule(dynamic,16)
+            for (int p=start; p<end; p++)
+            {
+                int i=members[p];
+                reduceRowByCluster(&normScores[i][0],k,offsets,members,
+                                   &distToCluster[0],&minToCluster[0],
+                                   &maxToCluster[0]);
+                size_t row=(size_t)(labels[i]-first)*k;
+                double *s=&threadSums[row];
+                float *lo=&threadMin[row];
+                float *hi=&threadMax[row];
+                #pragma omp simd
+                for (int c=0; c<k; c++)
+                {
+                    s[c]+=distToCluster[c];
+                    lo[c] = (minToCluster[c]<lo[c]) ? minToCluster[c] : lo[c];
+                    hi[c] = (maxToCluster[c]>hi[c]) ? maxToCluster[c] : hi[c];
+                }
+            }
+            #pragma omp critical
+            {
+                size_t base=(size_t)first*k;
+                for (size_t e=0; e<(size_t)rows*k; e++)
+                {
+                    sums[base+e]+=threadSums[e];
+                    minDistance[base+e] = (threadMin[e]<minDistance[base+e]) ?
+                                          threadMin[e] : minDistance[base+e];
+                    maxDistance[base+e] = (threadMax[e]>maxDistance[base+e]) ?
+                                          threadMax[e] : maxDistance[base+e];
+                }
+            }
+        }
+    }
+
+    /* Averages over the pairs; the diagonal excludes the distance of every
+       member to itself, and has no minimum */
+    for (int a=0; a<k; a++)
+    {
+        double sizeA=offsets[a+1]-offsets[a];
+        for (int b=0; b<k; b++)
+        {
+            size_t e=(size_t)a*k+b;
+            double pairs=sizeA*(offsets[b+1]-offsets[b]);
+            if (a==b)
+            {
+                pairs-=sizeA;
+                minDistance[e]=0;
+            }
+            avDistance[e]=(pairs>0) ? sums[e]/pairs : 0;
+        }
+    }
+}
+
+double estimateSilhouette(const vector< vector<float> > &normScores,
+                          const vector<int> &labels, int k, double tol,
+                          double &halfWidth, int &sampled)
+{
+    const double z=1.96;        // Normal quantile of the 95% interval
+    const int firstBatch=256;   // Elements drawn in the first round
+    int totalNodes=labels.size();
+    vector<int> offsets;
+    vector<int> members;        // Shuffled in place as they are drawn
+    groupByLabel(labels,k,offsets,members);
+
+    vector<int> taken(k,0);     // Members drawn from each cluster, the first
+                                // taken[c] of its range in members
+    vector<double> sum(k,0);    // Sum of s(i) over them
+    vector<double> sumSq(k,0);  // Sum of s(i)^2 over them
+    vector<int> picks;
+    vector<double> values;
+    double estimate=0;
+    halfWidth=0;
+    int batch=firstBatch;
+    while (true)
+    {
+        /* Stratified draw without replacement, proportional to the cluster
+           sizes and at least two per cluster so that every variance is
+           defined. Members of singletons have s(i)=0 and are not drawn. */
+        picks.clear();
+        for (int c=0; c<k; c++)
+        {
+            int size=offsets[c+1]-offsets[c];
+            if (size<2) continue;
+            int add=(int)ceil((double)batch*size/totalNodes);
+            add = (taken[c]+add<2) ? 2-taken[c] : add;
+            add = (add>size-taken[c]) ? size-taken[c] : add;
+            for (int t=0; t<add; t++)
+            {
+                int first=offsets[c]+taken[c];
+                int pick=first+rand()%(offsets[c+1]-first);
+                int swap=members[first];
+                members[first]=members[pick];
+                members[pick]=swap;
+                picks.push_back(members[first]);
+                taken[c]++;
+            }
+        }
+        if (picks.empty()) break;   // Every element has been drawn
+
+        int totalPicks=picks.size();
+        values.resize(totalPicks);
+        #pragma omp parallel
+        {
+            vector<double> distToCluster(k);
+            #pragma omp for schedule(dynamic,4)
+            for (int p=0; p<totalPicks; p++)
+            {
+                double a;
+                int i=picks[p];
+                elementSilhouette(&normScores[i][0],labels[i],k,offsets,
+                                  members,distToCluster,values[p],a);
+            }
+        }
+        for (int p=0; p<picks.size(); p++)
+        {
+            sum[labels[picks[p]]]+=values[p];
+            sumSq[labels[picks[p]]]+=values[p]*values[p];
+        }
+
+        /* Stratified mean and its variance, with the finite population
+           correction, so that the interval closes once all are drawn */
+        estimate=0;
+        double variance=0;
+        for (int c=0; c<k; c++)
+        {
+            int size=offsets[c+1]-offsets[c];
+            if (taken[c]==0) continue;
+            double weight=(double)size/totalNodes;
+            double mean=sum[c]/taken[c];
+            double var=(sumSq[c]-taken[c]*mean*mean)/(taken[c]-1);
+            var = (var>0) ? var : 0;
+            estimate+=weight*mean;
+            variance+=weight*weight*var/taken[c]*
+                      (1-(double)taken[c]/size);
+        }
+        halfWidth=z*sqrt(variance);
+        if (halfWidth<=tol) break;
+        batch*=2;
+    }
+    sampled=0;
+    for (int c=0; c<k; c++) sampled+=taken[c];
+    return estimate;
+}
+
+double calcMedoidSilhouette(const vector< vector<float> > &normScores,
+                            const vector<int> &labels,
+                            const vector<int> &medoids)
+{
+    const int blockSize=4096;   // Elements per block, as in assignToMedoids
+    int totalNodes=labels.size();
+    int k=medoids.size();
+    vector<int> clusterSize(k,0);
+    for (int i=0; i<totalNodes; i++)
+    {
+        clusterSize[labels[i]]++;
+    }
+
+    int totalBlocks=(totalNodes+blockSize-1)/blockSize;
+    double silhouetteSum=0;
+    #pragma omp parallel for schedule(static) reduction(+:silhouetteSum)
+    for (int block=0; block<totalBlocks; block++)
+    {
+        int start=block*blockSize;
+        int end=(start+blockSize<totalNodes) ? start+blockSize : totalNodes;
+        vector<float> own(end-start,0);     // Distance to the own medoid
+        vector<float> other(end-start,std::numeric_limits<float>::max());
+        const int *l=&labels[start];
+        float *o=&own[0];
+        float *b=&other[0];
+
+        /* The matrix is symmetric, so every medoid contributes one
+           contiguous pass over its row */
+        for (int c=0; c<k; c++)
+        {
+            const float *row=&normScores[medoids[c]][start];
+            for (int i=0; i<end-start; i++)
+            {
+                bool isOwn = l[i]==c;
+                o[i] = isOwn ? row[i] : o[i];
+                b[i] = (!isOwn && row[i]<b[i]) ? row[i] : b[i];
+            }
+        }
+        for (int i=0; i<end-start; i++)
+        {
+            if (clusterSize[l[i]]<2) continue;
+            if (b[i]==std::numeric_limits<float>::max()) continue;
+            double maxAB = (o[i]>b[i]) ? o[i] : b[i];
+            if (maxAB>0)
+            {
+                silhouetteSum+=(b[i]-o[i])/maxAB;
+            }
+        }
+    }
+    return (totalNodes>0) ? silhouetteSum/totalNodes : 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file stats.h
+ * @brief Definition of functions for clustering quality statistics
+ *
+ * Defines the functions that evaluate a clustering given as a label array
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+/**
+ * @struct ValidityIndices
+ * Internal validity indices of a clustering, all from one pass over the
+ * distance matrix
+ */
+struct ValidityIndices
+{
+    double silhouette;      // Average silhouette
+    double intraSum;        // Sum of a(i), as returned by calcSilhouette
+    float maxIntra;         // Largest distance within a cluster
+    float minInter;         // Smallest distance between two clusters
+    double avIntra;         // Average distance within clusters
+    double avInter;         // Average distance between clusters
+    double dunn;            // Dunn index, minInter/maxIntra
+    double daviesBouldin;   // Davies-Bouldin index, with medoids as centers
+};
+
+/**
+ * Groups the elements by label
+ * @param labels Label (0 to k-1) of every element
+ * @param k Number of different labels
+ * @param offsets Receives k+1 offsets: the elements with label c are
+ *               members[offsets[c]] to members[offsets[c+1]-1]
+ * @param members Receives the elements sorted by label, and by identifier
+ *               within a label
+ */
+void groupByLabel(const vector<int> &labels, int k,
+                  vector<int> &offsets, vector<int> &members);
+
+/**
+ * Calculates the average silhouette of a clustering. For every element i,
+ * a(i) is its average distance to the other members of its cluster and b(i)
+ * the smallest average distance to the members of another cluster;
+ * s(i)=(b(i)-a(i))/max(a(i),b(i)), and 0 for members of singletons.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param labels Label (0 to k-1) of every element
+ * @param k Number of different labels
+ * @return silhouette Average of s(i) over all the elements
+ */
+double calcSilhouette(const vector< vector<float> > &normScores,
+                      const vector<int> &labels, int k);
+
+/**
+ * Calculates the average silhouette of a clustering, as above, and the sum
+ * of a(i) over the members of clusters with at least two members. Every
+ * element is handled in one pass over its row of the distance matrix, which
+ * fills its row of the element by cluster table of distance sums; the
+ * elements are processed in parallel.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param labels Label (0 to k-1) of every element
+ * @param k Number of different labels
+ * @param intraSum Receives the sum of a(i)
+ * @return silhouette Average of s(i) over all the elements
+ */
+double calcSilhouette(const vector< vector<float> > &normScores,
+                      const vector<int> &labels, int k, double &intraSum);
+
+/**
+ * Calculates the silhouette as in calcSilhouette and, in the same parallel
+ * sweep of the rows of the distance matrix, the other validity indices: the
+ * Dunn index, the smallest distance between two clusters over the largest
+ * distance within a cluster (higher is better), and the Davies-Bouldin
+ * index, the average over the clusters of the largest (S_c+S_d)/d(m_c,m_d),
+ * where m_c is the medoid of cluster c and S_c the average distance of its
+ * members to it (lower is better). The averages run over the pairs of
+ * different elements.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param labels Label (0 to k-1) of every element
+ * @param medoids Identifier of the medoid of every label
+ * @param indices Receives the indices
+ */
+void calcValidityIndices(const vector< vector<float> > &normScores,
+                         const vector<int> &labels,
+                         const vector<int> &medoids,
+                         ValidityIndices &indices);
+
+/**
+ * Calculates the single, average and complete linkage distances between
+ * every pair of clusters in one parallel pass over the rows of the distance
+ * matrix. The rows of the k x k result are filled in blocks, so that the
+ * per-thread buffers stay small when there are thousands of clusters. The
+ * diagonal holds 0 as minimum, and the average and largest distance between
+ * different members of the cluster.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param labels Label (0 to k-1) of every element
+ * @param k Number of different labels
+ * @param minDistance Receives the k x k smallest distances, by rows
+ * @param avDistance Receives the k x k average distances, by rows
+ * @param maxDistance Receives the k x k largest distances, by rows
+ */
+void calcClusterDistances(const vector< vector<float> > &normScores,
+                          const vector<int> &labels, int k,
+                          vector<float> &minDistance,
+                          vector<float> &avDistance,
+                          vector<float> &maxDistance);
+
+/**
+ * Estimates the average silhouette from a stratified sample of the elements.
+ * Every round draws elements from each cluster, without replacement and in
+ * proportion to its size, and computes their exact s(i) in parallel. The
+ * stratified mean comes with a 95% normal confidence interval; the rounds
+ * double in size until its half width is at most tol, or until every
+ * element has been drawn and the estimate is exact. The elements are drawn
+ * with rand(), seeded once per run by main.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param labels Label (0 to k-1) of every element
+ * @param k Number of different labels
+ * @param tol Largest half width of the confidence interval
+ * @param halfWidth Receives the half width of the interval
+ * @param sampled Receives the number of elements whose s(i) was computed
+ * @return silhouette Estimate of the average of s(i) over all the elements
+ */
+double estimateSilhouette(const vector< vector<float> > &normScores,
+                          const vector<int> &labels, int k, double tol,
+                          double &halfWidth, int &sampled);
+
+/**
+ * Calculates the simplified silhouette of a clustering, which replaces the
+ * average distances to the members of a cluster by the distance to its
+ * medoid: a(i) is the distance to the medoid of its own cluster and b(i) the
+ * distance to the closest other medoid. It costs O(n*k) instead of O(n^2).
+ * Members of singletons count as 0, as in calcSilhouette.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param labels Label (0 to k-1) of every element
+ * @param medoids Identifier of the medoid of every label
+ * @return silhouette Average of s(i) over all the elements
+ */
+double calcMedoidSilhouette(const vector< vector<float> > &normScores,
+                            const vector<int> &labels,
+                            const vector<int> &medoids);
+
+#endif
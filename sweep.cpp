@@ -0,0 +1,849 @@
+/**
+ * @file sweep.cpp
+ * @brief Implementation of the cutoff sweep functions
+ *
+ * Implements the minimum spanning tree, the reusable engine state and the
+ * sweep driver that clusters the same data at several cutoffs
+ */
+
+#include <tr1/memory>
+#include <vector>
+#include <queue>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "node.h"
+#include "cluster.h"
+#include "kernels.h"
+#include "arena.h"
+#include "cluster_table.h"
+#include "link.h"
+#include "link_comparator.h"
+#include "clustering.h"
+#include "kmedoids.h"
+#include "input.h"
+#include "stats.h"
+#include "benchmark.h"
+#include "sweep.h"
+
+using namespace std;
+using namespace std::tr1;
+
+
+/**
+ * Orders links by increasing distance
+ */
+static bool shorterLink(Link a, Link b)
+{
+    return a.getDistance()<b.getDistance();
+}
+
+void buildSpanningTree(const vector< vector<float> > &normScores,
+                       vector<Link> &tree)
+{
+    int totalNodes=normScores.size();
+    tree.clear();
+    if (totalNodes<2) return;
+    tree.reserve(totalNodes-1);
+    vector<float> closest(totalNodes,std::numeric_limits<float>::max());
+    vector<int> closestTo(totalNodes,0);    // Tree element at that distance
+    vector<char> inTree(totalNodes,0);
+    int last=0;                             // Element added last
+    inTree[0]=1;
+    for (int added=1; added<totalNodes; added++)
+    {
+        /* Relax the distances through the element added last and pick the
+           closest element outside the tree */
+        const float *row=&normScores[last][0];
+        float best=std::numeric_limits<float>::max();
+        int next=-1;
+        for (int j=0; j<totalNodes; j++)
+        {
+            if (inTree[j]) continue;
+            if (row[j]<closest[j])
+            {
+                closest[j]=row[j];
+                closestTo[j]=last;
+            }
+            if (next<0 || closest[j]<best)
+            {
+                best=closest[j];
+                next=j;
+            }
+        }
+        tree.push_back(Link(closestTo[next],next,best));
+        inTree[next]=1;
+        last=next;
+    }
+    stable_sort(tree.begin(),tree.end(),shorterLink);
+}
+
+/**
+ * Finds the root of an element in the union-find of a sweep, halving the
+ * path on the way
+ */
+static int findRoot(vector<int> &parent, int i)
+{
+    while (parent[i]!=i)
+    {
+        parent[i]=parent[parent[i]];
+        i=parent[i];
+    }
+    return i;
+}
+
+/**
+ * Resets the union-find of a single-linkage sweep, and drops the distance
+ * sums of its clusters
+ */
+static void resetRoots(SweepState &state)
+{
+    for (int i=0; i<state.totalNodes; i++) state.parent[i]=i;
+    state.treeEdges=0;
+    state.clusterSums.clear();
+    state.clusterSums.resize(state.totalNodes);
+    state.clusterSizes.assign(state.totalNodes,1);
+    state.sumsReady=false;
+}
+
+/**
+ * Builds the distance sums of the current single-linkage clusters of a
+ * sweep in one pass over the distance matrix, adding the row of every
+ * member into the column of its root
+ */
+static void buildSums(const vector< vector<float> > &normScores,
+                      SweepState &state)
+{
+    int totalNodes=state.totalNodes;
+    for (int i=0; i<totalNodes; i++)
+    {
+        int root=findRoot(state.parent,i);
+        if (state.clusterSizes[root]<2) continue;
+        vector<double> &column=state.clusterSums[root];
+        if (column.empty()) column.assign(totalNodes,0);
+        double *sums=&column[0];
+        const float *row=&normScores[i][0];
+        #pragma omp simd
+        for (int j=0; j<totalNodes; j++) sums[j]+=row[j];
+    }
+    state.sumsReady=true;
+}
+
+/**
+ * Adds the distance sums of the cluster of root gone to the ones of root
+ * keep, whose clusters are merged. The sums of an element alone are its row
+ * of the distance matrix, copied only when it first absorbs another cluster.
+ */
+static void mergeSums(const vector< vector<float> > &normScores,
+                      SweepState &state, int keep, int gone)
+{
+    int totalNodes=state.totalNodes;
+    vector<double> &kept=state.clusterSums[keep];
+    if (kept.empty())
+    {
+        kept.assign(normScores[keep].begin(),normScores[keep].end());
+    }
+    double *sums=&kept[0];
+    vector<double> &merged=state.clusterSums[gone];
+    if (merged.empty())
+    {
+        const float *row=&normScores[gone][0];
+        #pragma omp simd
+        for (int i=0; i<totalNodes; i++) sums[i]+=row[i];
+    }
+    else
+    {
+        const double *column=&merged[0];
+        #pragma omp simd
+        for (int i=0; i<totalNodes; i++) sums[i]+=column[i];
+        vector<double>().swap(merged);
+    }
+}
+
+/**
+ * Average silhouette of the current single-linkage clusters of a sweep,
+ * from the distance sums of the clusters instead of the distance matrix:
+ * O(n k) instead of O(n^2), with the conventions of calcSilhouette
+ */
+static double trackedSilhouette(const vector< vector<float> > &normScores,
+                                SweepState &state, const vector<int> &labels,
+                                int k)
+{
+    const int blockSize=256;        // Elements sharing a pass over the sums
+    int totalNodes=state.totalNodes;
+    if (k<2) return 0;
+    vector<const double *> sums(k,(const double *)0);   // Sums of each label,
+    vector<const float *> rows(k,(const float *)0);     // or its matrix row
+    vector<int> sizes(k);
+    for (int i=0; i<totalNodes; i++)
+    {
+        int c=labels[i];
+        if (rows[c] || sums[c]) continue;
+        int root=findRoot(state.parent,i);
+        sizes[c]=state.clusterSizes[root];
+        if (state.clusterSums[root].empty()) rows[c]=&normScores[root][0];
+        else sums[c]=&state.clusterSums[root][0];
+    }
+
+    double silhouetteSum=0;
+    #pragma omp parallel reduction(+:silhouetteSum)
+    {
+        double b[blockSize];
+        #pragma omp for schedule(dynamic)
+        for (int first=0; first<totalNodes; first+=blockSize)
+        {
+            int count = (totalNodes-first<blockSize) ? totalNodes-first :
+                                                       blockSize;
+            const int *own=&labels[first];
+            for (int i=0; i<count; i++) b[i]=std::numeric_limits<double>::max();
+            for (int c=0; c<k; c++)
+            {
+                double inverse=1.0/sizes[c];
+                if (sums[c])
+                {
+                    const double *column=sums[c]+first;
+                    for (int i=0; i<count; i++)
+                    {
+                        double avInter=column[i]*inverse;
+                        b[i] = (own[i]!=c && avInter<b[i]) ? avInter : b[i];
+                    }
+                }
+                else
+                {
+                    const float *row=rows[c]+first;
+                    for (int i=0; i<count; i++)
+                    {
+                        double avInter=row[i]*inverse;
+                        b[i] = (own[i]!=c && avInter<b[i]) ? avInter : b[i];
+                    }
+                }
+            }
+            for (int i=0; i<count; i++)
+            {
+                int size=sizes[own[i]];
+                if (size<2) continue;
+                double a=sums[own[i]][first+i]/(size-1);
+                double maxAB = (a>b[i]) ? a : b[i];
+                if (maxAB>0) silhouetteSum+=(b[i]-a)/maxAB;
+            }
+        }
+    }
+    return silhouetteSum/totalNodes;
+}
+
+/**
+ * Labels the elements by the cluster of the Nodes of a run, numbering the
+ * active clusters in list order
+ * @return k Number of clusters
+ */
+static int labelsFromClusters(const SweepState &state, vector<int> &labels)
+{
+    vector<int> clusterIndex(state.totalClusters>state.clusterList.size() ?
+                             state.totalClusters : state.clusterList.size(),-1);
+    int k=0;
+    for (int i=0; i<state.clusterList.size(); i++)
+    {
+        if (state.clusterList[i]->getStatus())
+        {
+            clusterIndex[state.clusterList[i]->getID()]=k++;
+        }
+    }
+    labels.resize(state.nodeList.size());
+    for (int i=0; i<state.nodeList.size(); i++)
+    {
+        labels[i]=clusterIndex[state.nodeList[i]->getCluster()];
+    }
+    return k;
+}
+
+void sampleDistances(const vector< vector<float> > &normScores, int samples,
+                     vector<float> &sorted)
+{
+    int totalNodes=normScores.size();
+    double totalPairs=(double)totalNodes*(totalNodes-1)/2;
+    sorted.clear();
+    if (totalPairs<=samples)
+    {
+        for (int i=0; i<totalNodes; i++)
+        {
+            for (int j=i+1; j<totalNodes; j++) sorted.push_back(normScores[i][j]);
+        }
+    }
+    else
+    {
+        sorted.reserve(samples);
+        while (sorted.size()<samples)
+        {
+            int i=rand()%totalNodes;
+            int j=rand()%totalNodes;
+            if (i!=j) sorted.push_back(normScores[i][j]);
+        }
+    }
+    sort(sorted.begin(),sorted.end());
+}
+
+/**
+ * @struct CloserInRow
+ * Orders the columns of a row of the distance matrix by increasing distance,
+ * then by index
+ */
+struct CloserInRow
+{
+    const float *row;
+    CloserInRow(const float *r) : row(r) {};
+    bool operator()(int a, int b) const
+    {
+        return row[a]<row[b] || (row[a]==row[b] && a<b);
+    }
+};
+
+/**
+ * Sorts the elements by increasing distance from every element, leaving out
+ * the negative distances. The neighbours of i below a cutoff are then a
+ * prefix of neighbours[i].
+ */
+static void buildNeighbourIndex(const vector< vector<float> > &normScores,
+                                vector< vector<int> > &neighbours)
+{
+    int totalNodes=normScores.size();
+    neighbours.resize(totalNodes);
+    #pragma omp parallel for schedule(dynamic)
+    for (int i=0; i<totalNodes; i++)
+    {
+        const float *row=&normScores[i][0];
+        vector<int> &order=neighbours[i];
+        order.clear();
+        for (int j=0; j<totalNodes; j++)
+        {
+            if (row[j]>=0) order.push_back(j);
+        }
+        sort(order.begin(),order.end(),CloserInRow(row));
+    }
+}
+
+/**
+ * Number of leading neighbours of an element closer than the cutoff
+ */
+static int neighboursBelow(const vector< vector<float> > &normScores,
+                           const vector<int> &order, int i, float cutoff)
+{
+    const float *row=&normScores[i][0];
+    int low=0, high=order.size();
+    while (low<high)
+    {
+        int mid=(low+high)/2;
+        if (row[order[mid]]<cutoff) low=mid+1;
+        else high=mid;
+    }
+    return low;
+}
+
+/**
+ * SPICKER on the neighbour index: the same clusters as doSpickerCutoff, but
+ * the neighbour counts are computed once with a binary search per row and
+ * decremented when an element is clustered, instead of recounting the whole
+ * matrix for every cluster
+ * @return k Number of clusters
+ */
+static int spickerOnIndex(const vector< vector<float> > &normScores,
+                          const vector< vector<int> > &neighbours,
+                          float cutoff, vector<int> &labels)
+{
+    int totalNodes=normScores.size();
+    vector<int> reach(totalNodes);      // Neighbours closer than the cutoff
+    vector<int> count(totalNodes);      // Those not clustered yet
+    for (int i=0; i<totalNodes; i++)
+    {
+        reach[i]=neighboursBelow(normScores,neighbours[i],i,cutoff);
+        count[i]=reach[i];
+    }
+    labels.assign(totalNodes,-1);
+    int orphans=totalNodes;
+    int k=0;
+    while (orphans>0)
+    {
+        int maxRow=-1;
+        int maxNb=0;
+        for (int i=0; i<totalNodes; i++)
+        {
+            maxRow = count[i]>=maxNb ? i : maxRow;
+            maxNb = count[i]>=maxNb ? count[i] : maxNb;
+        }
+        if (maxNb==0) break;        // Only with a cutoff of 0 or less
+        const vector<int> &row=neighbours[maxRow];
+        for (int t=0; t<reach[maxRow]; t++)
+        {
+            int j=row[t];
+            if (labels[j]>=0) continue;
+            labels[j]=k;
+            orphans--;
+            const vector<int> &column=neighbours[j];
+            for (int u=0; u<reach[j]; u++) count[column[u]]--;
+        }
+        k++;
+    }
+    for (int i=0; i<totalNodes; i++)     // Left over by a cutoff of 0
+    {
+        if (labels[i]<0) labels[i]=k++;
+    }
+    return k;
+}
+
+void initSweep(int clusterAlg, const vector< vector<float> > &normScores,
+               const RunOptions &options, SweepState &state)
+{
+    state.clusterAlg=clusterAlg;
+    state.totalNodes=normScores.size();
+    state.options=options;
+    state.treeEdges=0;
+    state.trackSums=false;
+    state.sumsReady=false;
+    state.totalClusters=0;
+    if (clusterAlg==0)
+    {
+        buildSpanningTree(normScores,state.tree);
+        state.parent.resize(state.totalNodes);
+        resetRoots(state);
+    }
+    else if (clusterAlg==1)
+    {
+        buildNeighbourIndex(normScores,state.neighbours);
+    }
+    else if (clusterAlg==3 || clusterAlg==4)
+    {
+        initLinks(state.totalNodes,normScores,state.links);
+    }
+}
+
+int clusterAtCutoff(const vector< vector<float> > &normScores, float cutoff,
+                    SweepState &state, vector<int> &labels)
+{
+    int totalNodes=state.totalNodes;
+    if (state.clusterAlg==0)
+    {
+        /* Single linkage joins the elements connected by links shorter than
+           the cutoff, the same components as the tree edges below it */
+        if (state.treeEdges>0 &&
+            state.tree[state.treeEdges-1].getDistance()>=cutoff)
+        {
+            resetRoots(state);
+        }
+        while (state.treeEdges<state.tree.size() &&
+               state.tree[state.treeEdges].getDistance()<cutoff)
+        {
+            Link &edge=state.tree[state.treeEdges++];
+            int a=findRoot(state.parent,edge.getNodeA());
+            int b=findRoot(state.parent,edge.getNodeB());
+            int keep = (a<b) ? a : b;
+            int gone = (a>b) ? a : b;
+            state.parent[gone]=keep;
+            if (state.sumsReady) mergeSums(normScores,state,keep,gone);
+            state.clusterSizes[keep]+=state.clusterSizes[gone];
+        }
+        labels.resize(totalNodes);
+        vector<int> rootLabel(totalNodes,-1);
+        int k=0;
+        for (int i=0; i<totalNodes; i++)
+        {
+            int root=findRoot(state.parent,i);
+            if (rootLabel[root]<0) rootLabel[root]=k++;
+            labels[i]=rootLabel[root];
+        }
+        return k;
+    }
+
+    if (state.clusterAlg==1)
+    {
+        return spickerOnIndex(normScores,state.neighbours,cutoff,labels);
+    }
+
+    if (state.clusterAlg==3 || state.clusterAlg==4)
+    {
+        state.arena.reset();
+        state.table.init(state.arena,totalNodes);
+        state.runLinks=state.links;     // Reuses the buffer of the last run
+        if (state.clusterAlg==3)
+        {
+            doStrictHierarchicalCutoff(state.runLinks,state.table,cutoff,
+                                       normScores);
+        }
+        else
+        {
+            doUPGMA(state.runLinks,state.table,cutoff,normScores);
+        }
+        labels.resize(totalNodes);
+        vector<int> rootLabel(2*totalNodes,-1);     // Merges add new IDs
+        int k=0;
+        for (int i=0; i<totalNodes; i++)
+        {
+            int root=state.table.find(i);
+            if (rootLabel[root]<0) rootLabel[root]=k++;
+            labels[i]=rootLabel[root];
+        }
+        return k;
+    }
+
+    state.nodeList.clear();
+    state.clusterList.clear();
+    state.totalClusters=0;
+    initNodesAndClusters(totalNodes,state.nodeList,state.clusterList,
+                         state.totalClusters);
+    const RunOptions &options=state.options;
+    switch (state.clusterAlg)
+    {
+        case 2:
+            doKMeans(totalNodes,normScores,state.nodeList,state.clusterList,
+                     state.totalClusters,cutoff,options.approxSamples);
+            break;
+        case 5:
+            doClara(totalNodes,normScores,state.nodeList,state.clusterList,
+                    state.totalClusters,(int)cutoff,options.samples,
+                    options.sampleSize);
+            break;
+        case 7:
+            doKCenter(totalNodes,normScores,state.nodeList,state.clusterList,
+                      state.totalClusters,cutoff,options.maxCenters);
+            break;
+    }
+    return labelsFromClusters(state,labels);
+}
+
+/**
+ * @struct CutoffResult
+ * Clustering of a sweep at one cutoff and its evaluation
+ */
+struct CutoffResult
+{
+    float cutoff;               // Cutoff of the run
+    int k;                      // Number of clusters
+    int orphans;                // Clusters with a single member
+    double silhouette;          // Average silhouette
+    double clusterTime;         // Seconds spent clustering
+    double silhouetteTime;      // Seconds spent in the silhouette
+    vector<int> labels;         // Label of every element
+};
+
+/**
+ * Clusters the elements at the cutoff of every result, in order, and then
+ * computes the silhouettes of all of them, in parallel when there are at
+ * least as many cutoffs as threads, since they are independent. The engines
+ * build Clusters in the shared member pool, so the runs themselves are not
+ * concurrent. When a single-linkage sweep keeps the distance sums of its
+ * clusters, they are built once the clusters are at most 1/8 of the
+ * elements, and from then on each silhouette is read from them right after
+ * its run. This bounds the sums to a quarter of the size of the distance
+ * matrix, and each silhouette read from them to O(n^2/8).
+ */
+static void evaluateCutoffs(const vector< vector<float> > &normScores,
+                            SweepState &state, vector<CutoffResult> &results)
+{
+    const int sumsFactor=8;     // Elements per cluster before tracking sums
+    int totalCutoffs=results.size();
+    vector<int> pending;        // Results left for calcSilhouette
+    for (int s=0; s<totalCutoffs; s++)
+    {
+        CutoffResult &result=results[s];
+        result.clusterTime=wallTime();
+        result.k=clusterAtCutoff(normScores,result.cutoff,state,result.labels);
+        result.clusterTime=wallTime()-result.clusterTime;
+        vector<int> sizes(result.k,0);
+        for (int i=0; i<result.labels.size(); i++) sizes[result.labels[i]]++;
+        result.orphans=0;
+        for (int c=0; c<result.k; c++) result.orphans+=(sizes[c]==1);
+        result.silhouetteTime=wallTime();
+        if (state.trackSums && !state.sumsReady &&
+            (long)result.k*sumsFactor<=state.totalNodes)
+        {
+            buildSums(normScores,state);
+        }
+        if (state.sumsReady)
+        {
+            result.silhouette=trackedSilhouette(normScores,state,
+                                                result.labels,result.k);
+            result.silhouetteTime=wallTime()-result.silhouetteTime;
+        }
+        else
+        {
+            pending.push_back(s);
+        }
+    }
+    int totalPending=pending.size();
+
+    /* One cutoff per thread only when there are enough cutoffs for all the
+       threads; otherwise the loop runs on one thread and every
+       calcSilhouette spreads its elements over all of them */
+    int threads=1;
+#ifdef _OPENMP
+    threads=omp_get_max_threads();
+#endif
+    #pragma omp parallel for schedule(dynamic) if(totalPending>=threads)
+    for (int p=0; p<totalPending; p++)
+    {
+        CutoffResult &result=results[pending[p]];
+        result.silhouetteTime=wallTime();
+        result.silhouette=calcSilhouette(normScores,result.labels,result.k);
+        result.silhouetteTime=wallTime()-result.silhouetteTime;
+    }
+}
+
+/**
+ * Converts a cutoff of the distance matrix back to the units given by the
+ * user, similarities for -m 1
+ */
+static float givenCutoff(const RunOptions &options, float cutoff)
+{
+    return options.similarities ? 1-cutoff : cutoff;
+}
+
+/**
+ * Prints the line of one cutoff of a sweep, in the units given by the user
+ */
+static void printCutoffResult(const RunOptions &options,
+                              const CutoffResult &result)
+{
+    printf("Cutoff %f Clusters %d Orphans %d AvSil %f ClusterTime %f "
+           "SilTime %f\n",givenCutoff(options,result.cutoff),result.k,
+           result.orphans,result.silhouette,result.clusterTime,
+           result.silhouetteTime);
+}
+
+float doCutoffSweep(int clusterAlg, const vector< vector<float> > &normScores,
+                    const RunOptions &options,
+                    vector< shared_ptr<Node> > &nodeList,
+                    vector<shared_ptr<Cluster> > &clusterList,
+                    int &totalClusters)
+{
+    vector<float> cutoffs(options.cutoffs);
+    sort(cutoffs.begin(),cutoffs.end());
+    int totalCutoffs=cutoffs.size();
+
+    double setupTime=wallTime();
+    SweepState state;
+    initSweep(clusterAlg,normScores,options,state);
+    state.trackSums=(clusterAlg==0);
+    setupTime=wallTime()-setupTime;
+
+    vector<CutoffResult> results(totalCutoffs);
+    for (int s=0; s<totalCutoffs; s++) results[s].cutoff=cutoffs[s];
+    evaluateCutoffs(normScores,state,results);
+
+    /* The runs go by increasing distance; the lines follow the cutoffs as
+       given, by increasing similarity for -m 1 */
+    printf("Sweep setup %f s\n",setupTime);
+    int best=0;
+    for (int s=0; s<totalCutoffs; s++)
+    {
+        printCutoffResult(options,results[options.similarities ?
+                                          totalCutoffs-1-s : s]);
+        best = (results[s].silhouette>results[best].silhouette) ? s : best;
+    }
+    makeClustersFromLabels(results[best].labels,results[best].k,nodeList,
+                           clusterList,totalClusters);
+    return givenCutoff(options,cutoffs[best]);
+}
+
+/**
+ * Cutoff that leaves K single-linkage clusters, or at least K when edges of
+ * the same length cannot be told apart: joining the n-K shortest tree edges
+ * leaves K components, so it is the distance of the first edge left out
+ */
+static float treeCutoff(SweepState &state, int wanted)
+{
+    int edge = (state.totalNodes>wanted) ? state.totalNodes-wanted : 0;
+    if (edge<state.tree.size()) return state.tree[edge].getDistance();
+    if (state.tree.empty()) return 0;
+    return nextafterf(state.tree.back().getDistance(),
+                      std::numeric_limits<float>::max());
+}
+
+float doAutoCutoff(int clusterAlg, const vector< vector<float> > &normScores,
+                   const RunOptions &options,
+                   vector< shared_ptr<Node> > &nodeList,
+                   vector<shared_ptr<Cluster> > &clusterList,
+                   int &totalClusters)
+{
+    const int roundSize=8;          // Candidates evaluated together
+    double setupTime=wallTime();
+    SweepState state;
+    initSweep(clusterAlg,normScores,options,state);
+    state.trackSums=(clusterAlg==0);
+
+    /* Single linkage is searched over the number of clusters, on a log
+       scale from 1 to n, so that the few-cluster cuts at the longest tree
+       edges are in the first round; the other engines search the
+       quantiles of the distances up to the median */
+    int totalNodes=state.totalNodes;
+    vector<float> quantiles;
+    float high=0.5;
+    float resolution;               // Bracket too narrow to hold new cutoffs
+    if (clusterAlg==0)
+    {
+        high=1;
+        resolution=1.0/(totalNodes*(log((double)totalNodes)+1));
+    }
+    else
+    {
+        sampleDistances(normScores,65536,quantiles);
+        if (quantiles.empty()) quantiles.push_back(0);  // A single element
+        resolution=1.0/quantiles.size();
+    }
+    setupTime=wallTime()-setupTime;
+    printf("Sweep setup %f s\n",setupTime);
+
+    /* Coarse-to-fine grid: every round evaluates evenly spaced levels of
+       the bracket, its ends included, and narrows it to the neighbours of
+       the best one found so far */
+    float low=0;
+    float upper=high;               // The bracket never goes past it
+    int evaluations=0;
+    set<float> evaluated;           // Cutoffs run in earlier rounds
+    CutoffResult best;
+    float bestLevel=-1;
+    while (evaluations<options.maxEvals)
+    {
+        int count=options.maxEvals-evaluations;
+        count = (count>roundSize) ? roundSize : count;
+        vector<CutoffResult> results;
+        vector<float> levels;
+        for (int c=0; c<count; c++)
+        {
+            float level = (count>1) ? low+(high-low)*c/(count-1) :
+                                      (low+high)/2;
+            float cutoff;
+            if (clusterAlg==0)
+            {
+                int wanted=(int)floor(exp(level*log((double)totalNodes))+0.5);
+                cutoff=treeCutoff(state,wanted);
+            }
+            else
+            {
+                size_t index=(size_t)(level*quantiles.size());
+                index = (index<quantiles.size()) ? index : quantiles.size()-1;
+                cutoff=quantiles[index];
+            }
+            if (!evaluated.insert(cutoff).second) continue;
+            results.push_back(CutoffResult());
+            results.back().cutoff=cutoff;
+            levels.push_back(level);
+        }
+
+        /* The runs go by increasing distance, which for single linkage is
+           by decreasing level */
+        if (clusterAlg==0)
+        {
+            reverse(results.begin(),results.end());
+            reverse(levels.begin(),levels.end());
+        }
+        if (!results.empty())
+        {
+            evaluateCutoffs(normScores,state,results);
+            evaluations+=results.size();
+        }
+        for (int s=0; s<results.size(); s++)
+        {
+            printCutoffResult(options,results[s]);
+            if (bestLevel<0 || results[s].silhouette>best.silhouette)
+            {
+                best=results[s];
+                bestLevel=levels[s];
+            }
+        }
+        if (bestLevel<0) break;         // Not even one cutoff to run
+
+        /* A round with nothing new narrows as much as a full one, and the
+           search ends when the bracket cannot hold new cutoffs */
+        int spacing = results.empty() ? roundSize : count;
+        float step=(high-low)/((spacing>1) ? spacing-1 : 2);
+        low = (bestLevel-step>0) ? bestLevel-step : 0;
+        high = (bestLevel+step<upper) ? bestLevel+step : upper;
+        if (high-low<resolution) break;
+    }
+    printf("Auto cutoff %f AvSil %f after %d evaluations\n",
+           givenCutoff(options,best.cutoff),best.silhouette,evaluations);
+    makeClustersFromLabels(best.labels,best.k,nodeList,clusterList,
+                           totalClusters);
+    return givenCutoff(options,best.cutoff);
+}
+
+float doNumClusters(int clusterAlg, const vector< vector<float> > &normScores,
+                    const RunOptions &options,
+                    vector< shared_ptr<Node> > &nodeList,
+                    vector<shared_ptr<Cluster> > &clusterList,
+                    int &totalClusters)
+{
+    int wanted=options.numClusters;
+    SweepState state;
+    initSweep(clusterAlg,normScores,options,state);
+    int totalNodes=state.totalNodes;
+    float cutoff=0;
+    int probes=0;
+    if (clusterAlg==0)
+    {
+        cutoff=treeCutoff(state,wanted);
+    }
+    else
+    {
+        /* Bisection between the smallest positive distance, where every
+           element is alone, and just above the largest one, where they are
+           all together, keeping a cutoff with at least K clusters */
+        float low=std::numeric_limits<float>::max();
+        float high=0;
+        for (int i=0; i<totalNodes; i++)
+        {
+            const vector<int> &order=state.neighbours[i];
+            for (int t=0; t<order.size(); t++)
+            {
+                if (normScores[i][order[t]]>0)
+                {
+                    low = (normScores[i][order[t]]<low) ?
+                          normScores[i][order[t]] : low;
+                    break;
+                }
+            }
+            if (!order.empty())
+            {
+                high = (normScores[i][order.back()]>high) ?
+                       normScores[i][order.back()] : high;
+            }
+        }
+        high=nextafterf(high,std::numeric_limits<float>::max());
+        low = (low<high) ? low : high;
+        vector<int> labels;
+        int highCount=clusterAtCutoff(normScores,high,state,labels);
+        int lowCount=clusterAtCutoff(normScores,low,state,labels);
+        probes=2;
+        cutoff = (highCount>=wanted) ? high : low;
+        while (highCount<wanted && lowCount>wanted && probes<64)
+        {
+            float mid=low+(high-low)/2;
+            if (mid<=low || mid>=high) break;
+            int count=clusterAtCutoff(normScores,mid,state,labels);
+            probes++;
+            if (count>=wanted)
+            {
+                low=mid;
+                lowCount=count;
+            }
+            else
+            {
+                high=mid;
+                highCount=count;
+            }
+            cutoff=low;
+        }
+    }
+
+    vector<int> labels;
+    int k=clusterAtCutoff(normScores,cutoff,state,labels);
+    printf("Cutoff %f for %d clusters (%d wanted) after %d probes\n",
+           givenCutoff(options,cutoff),k,wanted,probes);
+    makeClustersFromLabels(labels,k,nodeList,clusterList,totalClusters);
+    return givenCutoff(options,cutoff);
+}
@@ -0,0 +1,172 @@
+/**
+ * @file sweep.h
+ * @brief Definition of the cutoff sweep functions
+ *
+ * Defines the state reused by the runs of a clustering engine at several
+ * cutoffs, the minimum spanning tree behind the single-linkage runs, and
+ * the sweep driver
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+/**
+ * @struct SweepState
+ * Everything a clustering engine needs that does not depend on the cutoff,
+ * built once by initSweep and reused by every clusterAtCutoff call.
+ * Single linkage only keeps the minimum spanning tree and a union-find of
+ * the elements, which is advanced incrementally while the cutoffs grow.
+ * A sweep that evaluates single linkage also keeps, once there are few
+ * enough clusters, the sums of the distances from all the elements to the
+ * members of each cluster: a merge adds the column of one cluster into the
+ * other, and the silhouette at a cutoff is read from the columns of the
+ * current clusters.
+ * SPICKER keeps the elements sorted by distance from every element, so that
+ * the neighbours below any cutoff are found without a scan of the matrix.
+ * The other hierarchical engines copy the prebuilt link heap into the
+ * same buffer and run on a table from the same arena. The remaining
+ * engines rebuild their Nodes and Clusters in the same vectors.
+ */
+struct SweepState
+{
+    int clusterAlg;                 // Engine, as the -s option
+    int totalNodes;                 // Number of elements
+    RunOptions options;             // Algorithm-specific parameters
+    vector<Link> tree;              // Minimum spanning tree, by increasing
+                                    // distance (single linkage)
+    vector<int> parent;             // Union-find of the elements joined by
+                                    // the first treeEdges edges of tree
+    int treeEdges;                  // Edges of tree merged into parent
+    bool trackSums;                 // Keep the distance sums below
+    bool sumsReady;                 // They hold the current clusters
+    vector< vector<double> > clusterSums;   // Distance from every element to
+                                            // the cluster of each root of
+                                            // parent, empty while the root
+                                            // is alone
+    vector<int> clusterSizes;       // Members of the cluster of each root
+    vector< vector<int> > neighbours;   // Elements by increasing distance
+                                        // from each element (SPICKER)
+    priority_queue<Link,vector<Link>,LinkComparator> links; // All links
+    priority_queue<Link,vector<Link>,LinkComparator> runLinks; // Copy used
+                                                               // by a run
+    Arena arena;                    // Memory of the table
+    ClusterTable table;             // State of a hierarchical run
+    vector< shared_ptr<Node> > nodeList;    // Nodes of a run
+    vector<shared_ptr<Cluster> > clusterList; // Clusters of a run
+    int totalClusters;              // Cluster IDs used by a run
+};
+
+/**
+ * Builds the minimum spanning tree of the complete graph of the elements
+ * with Prim's algorithm, in O(n^2) time straight from the distance matrix.
+ * Single-linkage clustering at a cutoff joins the elements connected by the
+ * tree edges shorter than the cutoff.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param tree Receives the n-1 edges, sorted by increasing distance
+ */
+void buildSpanningTree(const vector< vector<float> > &normScores,
+                       vector<Link> &tree);
+
+/**
+ * Samples the pairwise distances, all of them if there are at most samples
+ * pairs, and sorts them, so that sorted[q*sorted.size()] approximates the
+ * q quantile of the distances. The pairs are drawn with rand().
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param samples Number of distances to sample
+ * @param sorted Receives the sampled distances in increasing order
+ */
+void sampleDistances(const vector< vector<float> > &normScores, int samples,
+                     vector<float> &sorted);
+
+/**
+ * Prepares the reusable state of an engine for a sweep over cutoffs
+ * @param clusterAlg Engine, as the -s option; not the streaming k-medoids
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param options Algorithm-specific parameters
+ * @param state SweepState to fill
+ */
+void initSweep(int clusterAlg, const vector< vector<float> > &normScores,
+               const RunOptions &options, SweepState &state);
+
+/**
+ * Runs the engine of a sweep at one cutoff. Single linkage continues from
+ * the previous call when the cutoff did not decrease.
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param cutoff Cutoff of the run
+ * @param state SweepState prepared by initSweep
+ * @param labels Receives the label (0 to k-1) of every element
+ * @return k Number of clusters
+ */
+int clusterAtCutoff(const vector< vector<float> > &normScores, float cutoff,
+                    SweepState &state, vector<int> &labels);
+
+/**
+ * Clusters the elements at every cutoff of options.cutoffs, by increasing
+ * distance, reusing the state of the engine between runs, and prints one
+ * line per cutoff, by increasing cutoff in the units given by the user:
+ * number of clusters, orphans, average silhouette and the time spent
+ * clustering and in the silhouette. The silhouettes of the different
+ * cutoffs are computed in parallel, or one after the other on all the
+ * threads when there are fewer cutoffs than threads. The clustering with the largest
+ * silhouette replaces the current clusters of the elements.
+ * @param clusterAlg Engine, as the -s option; not the streaming k-medoids
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param options Algorithm-specific parameters, with the cutoffs
+ * @param nodeList Vector of shared pointers to the Nodes
+ * @param clusterList Vector of shared pointers to the Clusters
+ * @param totalClusters Total number of clusters
+ * @return cutoff Cutoff of the clustering kept, in the units given by the
+ *               user
+ */
+float doCutoffSweep(int clusterAlg, const vector< vector<float> > &normScores,
+                    const RunOptions &options,
+                    vector< shared_ptr<Node> > &nodeList,
+                    vector<shared_ptr<Cluster> > &clusterList,
+                    int &totalClusters);
+
+/**
+ * Searches the cutoff with the largest average silhouette. The candidates
+ * are quantiles of a sample of the distances, up to the median, or for
+ * single linkage the spanning tree cuts that leave 1 to n clusters, on a log
+ * scale of the number of clusters. They lie on a coarse-to-fine grid: every
+ * round evaluates up to 8 evenly spaced candidates, the ends of the bracket
+ * included, their silhouettes as in doCutoffSweep, and narrows the bracket
+ * to the neighbours of the best cutoff found. Every
+ * candidate is printed as a sweep line. The clustering at the best cutoff
+ * replaces the current clusters of the elements.
+ * @param clusterAlg Engine, as the -s option; one with a distance cutoff
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param options Algorithm-specific parameters, with the maximum number of
+ *               evaluations
+ * @param nodeList Vector of shared pointers to the Nodes
+ * @param clusterList Vector of shared pointers to the Clusters
+ * @param totalClusters Total number of clusters
+ * @return cutoff Best cutoff found, in the units given by the user
+ */
+float doAutoCutoff(int clusterAlg, const vector< vector<float> > &normScores,
+                   const RunOptions &options,
+                   vector< shared_ptr<Node> > &nodeList,
+                   vector<shared_ptr<Cluster> > &clusterList,
+                   int &totalClusters);
+
+/**
+ * Finds a cutoff that gives K clusters, or at least K when no cutoff gives
+ * exactly K, and keeps that clustering. Single linkage reads it off the
+ * minimum spanning tree: the K-1 longest edges are left out. SPICKER
+ * bisects the cutoff, every probe running on the sorted neighbours of the
+ * elements. The cutoff found and the number of probes are printed.
+ * @param clusterAlg Engine, as the -s option; single linkage or SPICKER
+ * @param normScores Vector of vector of floats represeting the distance matrix
+ * @param options Algorithm-specific parameters, with the number of clusters
+ * @param nodeList Vector of shared pointers to the Nodes
+ * @param clusterList Vector of shared pointers to the Clusters
+ * @param totalClusters Total number of clusters
+ * @return cutoff Cutoff found, in the units given by the user
+ */
+float doNumClusters(int clusterAlg, const vector< vector<float> > &normScores,
+                    const RunOptions &options,
+                    vector< shared_ptr<Node> > &nodeList,
+                    vector<shared_ptr<Cluster> > &clusterList,
+                    int &totalClusters);
+
+#endif